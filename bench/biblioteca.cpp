@@ -0,0 +1,131 @@
+/*Benchmark das bibliotecas tarefa1/estat.hpp e tarefa2/queda.hpp chamadas
+no proprio processo contra os programas estat e queda executados como
+processos separados.
+
+Gera um arquivo do estat e um do queda com --linhas linhas (padrao 10000)
+e, para cada programa, mede --repeticoes chamadas (padrao 50):
+
+  estat_processo, queda_processo      executa o programa sobre o arquivo
+                                      (inicio do processo, leitura, calculo
+                                      e formatacao da saida)
+  estat_biblioteca, queda_biblioteca  chama estatisticas e analyze_trajectory
+                                      sobre os valores ja na memoria
+
+As linhas estao no formato de medidas.hpp, com a vazao em MB/s do arquivo
+de entrada. O rss_kb dos casos de biblioteca e o deste processo durante o
+caso, com os valores ja na memoria.
+
+Uso: biblioteca <caminho do estat> <caminho do queda> [--linhas N] [--repeticoes R] [--dir D]
+Compilar: g++ -std=c++17 -O2 -pthread bench/biblioteca.cpp -o biblioteca
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "../tarefa1/estat.hpp"
+#include "../tarefa2/queda.hpp"
+#include "dados.hpp"
+#include "medidas.hpp"
+#include "processo.hpp"
+
+// Tamanho de um arquivo em bytes.
+size_t tamanho_do_arquivo(std::string const &arquivo) {
+  struct stat st;
+  stat(arquivo.c_str(), &st);
+  return st.st_size;
+}
+
+// Executa o comando repeticoes vezes e imprime a medida.
+void caso_processo(std::string const &nome, std::vector<std::string> const &comando,
+                   std::string const &entrada, size_t repeticoes) {
+  Medida m{nome, tamanho_do_arquivo(entrada), repeticoes, 0, "MB/s", {}, 0};
+  double total = 0;
+  for (size_t i = 0; i < repeticoes; ++i) {
+    long rss;
+    double t = executa(comando, rss);
+    if (t < 0) {
+      std::cerr << "Falha executando o caso " << nome << std::endl;
+      return;
+    }
+    total += t;
+    m.latencias_us.push_back(t*1e6);
+    m.rss_kb = std::max(m.rss_kb, rss);
+  }
+  m.vazao = m.tamanho/1e6/(total/repeticoes);
+  imprime(std::cout, m);
+}
+
+// Chama f repeticoes vezes e imprime a medida. O resultado de f e conferido
+// (tem que ser finito), o que tambem impede o compilador de eliminar as
+// chamadas.
+template<typename F>
+void caso_biblioteca(std::string const &nome, std::string const &entrada, size_t repeticoes, F f) {
+  Medida m{nome, tamanho_do_arquivo(entrada), repeticoes, 0, "MB/s", {}, 0};
+  double total = 0;
+  size_t invalidos = 0;
+  reinicia_rss_pico();
+  for (size_t i = 0; i < repeticoes; ++i) {
+    auto inicio = std::chrono::steady_clock::now();
+    if (!std::isfinite(f())) ++invalidos;
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - inicio;
+    total += t.count();
+    m.latencias_us.push_back(t.count()*1e6);
+  }
+  m.vazao = m.tamanho/1e6/(total/repeticoes);
+  m.rss_kb = rss_pico_kb();
+  imprime(std::cout, m);
+  if (invalidos) std::cerr << nome << ": " << invalidos << " resultados invalidos" << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <estat> <queda> [--linhas N] [--repeticoes R] [--dir D]\n";
+    return 1;
+  }
+  std::string estat = argv[1], queda = argv[2];
+  std::string dir = "/tmp";
+  size_t linhas = 10000, repeticoes = 50;
+  for (int i = 3; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--linhas") linhas = std::stoul(argv[i + 1]);
+    else if (arg == "--repeticoes") repeticoes = std::stoul(argv[i + 1]);
+    else if (arg == "--dir") dir = argv[i + 1];
+  }
+
+  std::string arquivo_estat = dir + "/bench_biblioteca_estat.dat";
+  std::string arquivo_queda = dir + "/bench_biblioteca_queda.dat";
+  {
+    std::ofstream out(arquivo_estat);
+    gera_estat(out, linhas, Distribuicao::normal, 42);
+  }
+  {
+    std::ofstream out(arquivo_queda);
+    gera_queda(out, linhas, 42);
+  }
+
+  imprime_cabecalho(std::cout);
+
+  caso_processo("estat_processo", {estat, arquivo_estat, "10"}, arquivo_estat, repeticoes);
+  auto valores = read_file(arquivo_estat.c_str());
+  caso_biblioteca("estat_biblioteca", arquivo_estat, repeticoes, [&] {
+    return estatisticas(valores, 10).mean;
+  });
+
+  caso_processo("queda_processo", {queda, arquivo_queda}, arquivo_queda, repeticoes);
+  Positions<float> posicoes(arquivo_queda);
+  caso_biblioteca("queda_biblioteca", arquivo_queda, repeticoes, [&] {
+    return analyze_trajectory(posicoes.time.span(), posicoes.height.span()).fit.g.value();
+  });
+
+  std::remove(arquivo_estat.c_str());
+  std::remove(arquivo_queda.c_str());
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*Benchmark das buscas do OrderedUniqueValues (tarefa 4): uma a uma, em lote
+(find_many e find_range_many) e na versao congelada
+(FrozenOrderedUniqueValues), em conjuntos so de leitura.
+
+Para cada tamanho n de 10^5 ate --max (padrao 10^7, de 10 em 10) carrega
+n chaves inteiras aleatorias em [-n, n] e mede --consultas buscas (padrao
+10^6) de chaves aleatorias na mesma faixa:
+
+  find                 find de cada chave
+  find_range           find_range de [chave, chave + 100], um decimo das
+                       consultas
+  find_many            find_many sobre cada lote de chaves
+  find_range_many      find_range_many sobre cada lote de faixas
+  find_ordenadas       find com as chaves em ordem crescente
+  find_many_ordenadas  find_many com as chaves em ordem (merge-join)
+
+com o prefixo t4 para o vetor ordenado e frozen para a arvore B+ implicita
+(so find e find_range).
+As linhas estao no formato de medidas.hpp; as latencias sao medidas em lotes
+de 1000 operacoes e divididas pelo tamanho do lote, e o tamanho e o n do
+conjunto.
+
+Uso: busca [--max N] [--consultas M]
+Compilar: g++ -std=c++17 -O2 bench/busca.cpp -o busca
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../tarefa4/frozen_ordered_unique_values.hpp"
+#include "../tarefa4/ordered_unique_values.hpp"
+#include "dados.hpp"
+#include "medidas.hpp"
+
+size_t const lote = 1000;
+
+// Executa op(i, fim) para os lotes [i, fim) de [0, m), medindo cada lote.
+template<typename F>
+Medida mede_lotes(std::string const &caso, size_t n, size_t m, F op) {
+  Medida r{caso, n, 1, 0, "ops/s", {}, 0};
+  reinicia_rss_pico();
+  auto inicio = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < m; i += lote) {
+    auto t0 = std::chrono::steady_clock::now();
+    size_t fim = std::min(m, i + lote);
+    op(i, fim);
+    std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - t0;
+    r.latencias_us.push_back(dt.count()/(fim - i));
+  }
+  std::chrono::duration<double> total = std::chrono::steady_clock::now() - inicio;
+  r.vazao = m/total.count();
+  r.rss_kb = rss_pico_kb();
+  return r;
+}
+
+// Executa op(i) para i em [0, m) em lotes, medindo cada lote.
+template<typename F>
+Medida mede(std::string const &caso, size_t n, size_t m, F op) {
+  return mede_lotes(caso, n, m, [&](size_t i, size_t fim) {
+    for (size_t j = i; j < fim; ++j) op(j);
+  });
+}
+
+// Mede as buscas em lote, comparando com find sobre as chaves em ordem.
+void mede_lotes_t4(OrderedUniqueValues<int> const &conjunto, size_t n,
+                   std::vector<int> const &consultas, size_t &achados) {
+  using Faixa = std::pair<OrderedUniqueValues<int>::const_iterator,
+                          OrderedUniqueValues<int>::const_iterator>;
+  size_t m = consultas.size();
+  std::unique_ptr<bool[]> achou(new bool[lote]);
+  std::vector<Faixa> faixas(lote);
+  std::vector<int> maximos(consultas);
+  for (auto &x: maximos) x += 100;
+  auto conta = [&](size_t k) {
+    for (size_t j = 0; j < k; ++j) achados += achou[j];
+  };
+
+  imprime(std::cout, mede_lotes("t4_find_many", n, m, [&](size_t i, size_t fim) {
+    conjunto.find_many(consultas.data() + i, fim - i, achou.get());
+    conta(fim - i);
+  }));
+  imprime(std::cout, mede_lotes("t4_find_range_many", n, m/10, [&](size_t i, size_t fim) {
+    conjunto.find_range_many(consultas.data() + i, maximos.data() + i, fim - i, faixas.data());
+    for (size_t j = 0; j < fim - i; ++j) achados += faixas[j].second - faixas[j].first;
+  }));
+
+  auto ordenadas = consultas;
+  std::sort(ordenadas.begin(), ordenadas.end());
+  imprime(std::cout, mede("t4_find_ordenadas", n, m, [&](size_t i) {
+    achados += conjunto.find(ordenadas[i]);
+  }));
+  imprime(std::cout, mede_lotes("t4_find_many_ordenadas", n, m, [&](size_t i, size_t fim) {
+    conjunto.find_many(ordenadas.data() + i, fim - i, achou.get());
+    conta(fim - i);
+  }));
+}
+
+// Mede find e find_range de um conjunto.
+template<typename Conjunto>
+void mede_conjunto(std::string const &prefixo, Conjunto const &conjunto, size_t n,
+                   std::vector<int> const &consultas, size_t &achados) {
+  size_t m = consultas.size();
+  imprime(std::cout, mede(prefixo + "_find", n, m, [&](size_t i) {
+    achados += conjunto.find(consultas[i]);
+  }));
+  imprime(std::cout, mede(prefixo + "_find_range", n, m/10, [&](size_t i) {
+    auto [first, last] = conjunto.find_range(consultas[i], consultas[i] + 100);
+    achados += last - first;
+  }));
+}
+
+int main(int argc, char const *argv[]) {
+  size_t maximo = 10000000, m = 1000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--max") maximo = std::stoul(argv[i + 1]);
+    else if (arg == "--consultas") m = std::stoul(argv[i + 1]);
+  }
+
+  size_t achados = 0;
+  imprime_cabecalho(std::cout);
+  for (size_t n = 100000; n <= maximo; n *= 10) {
+    auto chaves = gera_chaves(n, int(n), 42);
+    auto consultas = gera_chaves(m, int(n), 43);
+    OrderedUniqueValues<int> conjunto(chaves.begin(), chaves.end());
+    mede_conjunto("t4", conjunto, n, consultas, achados);
+    mede_lotes_t4(conjunto, n, consultas, achados);
+    FrozenOrderedUniqueValues<int> congelado(conjunto);
+    mede_conjunto("frozen", congelado, n, consultas, achados);
+  }
+
+  // usa o resultado para o compilador nao eliminar as buscas
+  std::cerr << "achados: " << achados << std::endl;
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*Benchmark da carga de um OrderedUniqueValues com muitos valores: insert
+um a um contra insert_range e o construtor a partir de uma faixa.
+
+Para cada tamanho n de 10^4 ate --max (padrao 10^7, de 10 em 10) gera n
+chaves inteiras aleatorias em [-n, n] e mede, --repeticoes vezes (padrao 3):
+
+  insert         n chamadas a insert, O(n^2) movimentos de elementos; so
+                 ate --max-insert (padrao 10^5), acima disso levaria horas
+  insert_range   uma chamada a insert_range em um conjunto vazio
+  lotes          10 chamadas a insert_range com n/10 chaves cada, cada uma
+                 juntando o lote com os valores ja inseridos
+  construtor     o construtor a partir da faixa de iteradores
+
+As linhas estao no formato de medidas.hpp, com a vazao em valores inseridos
+por segundo e uma amostra de latencia (tempo total da carga) por repeticao.
+Com --max 100000000 o ultimo tamanho precisa de uns 1,5 GB de memoria.
+
+Uso: carga [--max N] [--max-insert N] [--repeticoes R]
+Compilar:
+  g++ -std=c++17 -O2 -DTAREFA3 bench/carga.cpp -o carga_t3
+  g++ -std=c++17 -O2 bench/carga.cpp -o carga_t4
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dados.hpp"
+#include "medidas.hpp"
+
+#ifdef TAREFA3
+#include "../tarefa3/ordered_unique_values.hpp"
+using Conjunto = OrderedUniqueValues;
+char const *const prefixo = "t3";
+#else
+#include "../tarefa4/ordered_unique_values.hpp"
+using Conjunto = OrderedUniqueValues<int>;
+char const *const prefixo = "t4";
+#endif
+
+// Mede repeticoes cargas de n valores; carga() retorna o conjunto carregado,
+// cujo tamanho e conferido com o esperado.
+template<typename F>
+void mede(std::string const &caso, size_t n, size_t repeticoes, size_t esperado, F carga) {
+  Medida m{std::string(prefixo) + "_" + caso, n, repeticoes, 0, "valores/s", {}, 0};
+  reinicia_rss_pico();
+  double total = 0;
+  for (size_t r = 0; r < repeticoes; ++r) {
+    auto inicio = std::chrono::steady_clock::now();
+    Conjunto conjunto = carga();
+    std::chrono::duration<double> t = std::chrono::steady_clock::now() - inicio;
+    total += t.count();
+    m.latencias_us.push_back(t.count()*1e6);
+    if (conjunto.size() != esperado) {
+      std::cerr << m.caso << ": " << conjunto.size() << " valores, esperados " << esperado
+                << std::endl;
+    }
+  }
+  m.vazao = n/(total/repeticoes);
+  m.rss_kb = rss_pico_kb();
+  imprime(std::cout, m);
+}
+
+int main(int argc, char const *argv[]) {
+  size_t maximo = 10000000, maximo_insert = 100000, repeticoes = 3;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--max") maximo = std::stoul(argv[i + 1]);
+    else if (arg == "--max-insert") maximo_insert = std::stoul(argv[i + 1]);
+    else if (arg == "--repeticoes") repeticoes = std::stoul(argv[i + 1]);
+  }
+
+  imprime_cabecalho(std::cout);
+  for (size_t n = 10000; n <= maximo; n *= 10) {
+    auto chaves = gera_chaves(n, int(n), 42);
+    size_t esperado = Conjunto(chaves.begin(), chaves.end()).size();
+
+    if (n <= maximo_insert) {
+      mede("insert", n, repeticoes, esperado, [&] {
+        Conjunto c;
+        for (auto k: chaves) c.insert(k);
+        return c;
+      });
+    }
+    mede("insert_range", n, repeticoes, esperado, [&] {
+      Conjunto c;
+      c.insert_range(chaves.begin(), chaves.end());
+      return c;
+    });
+    mede("lotes", n, repeticoes, esperado, [&] {
+      Conjunto c;
+      for (size_t i = 0; i < 10; ++i) {
+        c.insert_range(chaves.begin() + n*i/10, chaves.begin() + n*(i + 1)/10);
+      }
+      return c;
+    });
+    mede("construtor", n, repeticoes, esperado, [&] {
+      return Conjunto(chaves.begin(), chaves.end());
+    });
+  }
+  return 0;
+}
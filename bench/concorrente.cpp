@@ -0,0 +1,143 @@
+/*Benchmark de leituras concorrentes com um escritor: OrderedUniqueValues
+protegido por uma trava global (mutex), por uma trava de leitura e escrita
+(shared_mutex) e o ConcurrentOrderedUniqueValues (leitores sem travas).
+
+Carrega --chaves chaves (padrao 10^6) e, para cada numero de leitores de 1
+ate --leitores (padrao 8, dobrando), executa por --segundos (padrao 1) uma
+thread escritora inserindo sem parar chaves aleatorias na mesma faixa (cerca
+de metade novas) e os leitores fazendo find de chaves aleatorias. Para cada
+modo e numero de leitores imprime, no formato de medidas.hpp:
+
+  <modo>_leitores_<R>   todas as buscas, com a vazao somada dos leitores e
+                        as latencias de lotes de 1000 buscas
+  <modo>_escritor_<R>   os inserts do escritor no mesmo periodo
+
+Os leitores so escalam com o numero de leitores ate o numero de nucleos da
+maquina; acima disso as threads so dividem os nucleos.
+
+Uso: concorrente [--chaves N] [--leitores R] [--segundos S]
+Compilar: g++ -std=c++17 -O2 -pthread bench/concorrente.cpp -o concorrente
+*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../tarefa4/concurrent_ordered_unique_values.hpp"
+#include "../tarefa4/ordered_unique_values.hpp"
+#include "dados.hpp"
+#include "medidas.hpp"
+
+size_t const lote = 1000;
+
+// OrderedUniqueValues com uma trava para todas as operacoes.
+template<typename Mutex, typename ReadLock>
+class ComTrava {
+  OrderedUniqueValues<int> _conjunto;
+  mutable Mutex _trava;
+
+  public:
+    template<typename Iterator>
+    ComTrava(Iterator first, Iterator last) : _conjunto(first, last) {}
+
+    bool find(int x) const {
+      ReadLock trava(_trava);
+      return _conjunto.find(x);
+    }
+    void insert(int x) {
+      std::lock_guard<Mutex> trava(_trava);
+      _conjunto.insert(x);
+    }
+};
+
+using ComMutex = ComTrava<std::mutex, std::lock_guard<std::mutex>>;
+using ComSharedMutex = ComTrava<std::shared_mutex, std::shared_lock<std::shared_mutex>>;
+
+// Conjunto concorrente carregado com as chaves.
+struct Concorrente : ConcurrentOrderedUniqueValues<int> {
+  template<typename Iterator>
+  Concorrente(Iterator first, Iterator last) {
+    insert_range(first, last);
+  }
+};
+
+// Executa o escritor e leitores leitores sobre o conjunto e imprime as medidas.
+template<typename Conjunto>
+void mede(std::string const &modo, std::vector<int> const &chaves, int leitores,
+          double segundos) {
+  reinicia_rss_pico();
+  Conjunto conjunto(chaves.begin(), chaves.end());
+  size_t n = chaves.size();
+  auto novas = gera_chaves(n, int(n), 44);
+  auto consultas = gera_chaves(n, int(n), 43);
+
+  std::atomic<bool> parar{false};
+  std::atomic<size_t> achados{0};
+  std::vector<std::vector<double>> latencias(leitores);
+  std::vector<size_t> buscas(leitores, 0);
+  size_t inserts = 0;
+
+  std::vector<std::thread> threads;
+  threads.emplace_back([&] {
+    for (size_t i = 0; !parar.load(std::memory_order_relaxed); ++i) {
+      conjunto.insert(novas[i % n]);
+      ++inserts;
+    }
+  });
+  for (int r = 0; r < leitores; ++r) {
+    threads.emplace_back([&, r] {
+      size_t i = r*(n/leitores), achados_local = 0;
+      while (!parar.load(std::memory_order_relaxed)) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t j = 0; j < lote; ++j, ++i) achados_local += conjunto.find(consultas[i % n]);
+        std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - t0;
+        latencias[r].push_back(dt.count()/lote);
+        buscas[r] += lote;
+      }
+      achados += achados_local;
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(segundos));
+  parar = true;
+  for (auto &t: threads) t.join();
+
+  auto sufixo = "_" + std::to_string(leitores);
+  Medida leitura{modo + "_leitores" + sufixo, n, 0, 0, "ops/s", {}, rss_pico_kb()};
+  for (int r = 0; r < leitores; ++r) {
+    leitura.repeticoes += buscas[r];
+    leitura.latencias_us.insert(leitura.latencias_us.end(), latencias[r].begin(), latencias[r].end());
+  }
+  leitura.vazao = leitura.repeticoes/segundos;
+  imprime(std::cout, leitura);
+  Medida escrita{modo + "_escritor" + sufixo, n, inserts, inserts/segundos, "ops/s", {}, rss_pico_kb()};
+  imprime(std::cout, escrita);
+
+  // usa o resultado para o compilador nao eliminar as buscas
+  if (achados == 0) std::cerr << modo << ": nenhuma chave achada" << std::endl;
+}
+
+int main(int argc, char const *argv[]) {
+  size_t n = 1000000;
+  int maximo_leitores = 8;
+  double segundos = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--chaves") n = std::stoul(argv[i + 1]);
+    else if (arg == "--leitores") maximo_leitores = std::stoi(argv[i + 1]);
+    else if (arg == "--segundos") segundos = std::stod(argv[i + 1]);
+  }
+
+  auto chaves = gera_chaves(n, int(n), 42);
+  imprime_cabecalho(std::cout);
+  for (int leitores = 1; leitores <= maximo_leitores; leitores *= 2) {
+    mede<ComMutex>("mutex", chaves, leitores, segundos);
+    mede<ComSharedMutex>("shared_mutex", chaves, leitores, segundos);
+    mede<Concorrente>("concorrente", chaves, leitores, segundos);
+  }
+  return 0;
+}
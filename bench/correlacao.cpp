@@ -0,0 +1,172 @@
+/*Benchmark da propagacao de erros do queda: operadores independentes
+(padrao) contra --correlated (TrackedMeasurement).
+
+Gera --amostras trajetorias (padrao 100) de --linhas pontos (padrao 1000),
+iguais a menos do ruido (sementes diferentes), e executa o queda --batch
+--velocities em double sobre todas elas, sem e com --correlated. Como os
+erros reportados deveriam ser o desvio padrao dos resultados entre as
+amostras, cada modo e comparado com a dispersao observada. Imprime,
+separados por tabulacoes:
+
+  caso  p50_us  rss_kb  erro_g  dispersao_g  razao_g  razao_v_p50
+
+p50_us e a mediana do tempo das execucoes (todas as amostras em um
+processo, uma thread) e rss_kb o maior pico de memoria residente. erro_g e
+a media dos erros de g reportados, dispersao_g o desvio padrao de g entre
+as amostras e razao_g = dispersao_g/erro_g. razao_v_p50 e a mediana, entre
+os instantes, da mesma razao para as velocidades. As razoes ficam perto de 1
+quando o erro reportado esta certo (com a incerteza de uma estimativa com
+--amostras valores). A aproximacao linear so vale enquanto o intervalo entre
+dois pontos e bem maior que o erro dos tempos: com os dados de dados.hpp
+(10 s, erro de 0.5 ms) ate uns 5000 pontos. Para medir o tempo em
+trajetorias grandes use por exemplo --linhas 1000000 --amostras 2 e ignore
+as razoes.
+
+Uso: correlacao <caminho do queda> [--linhas N] [--amostras K] [--repeticoes R] [--dir D]
+Compilar: g++ -std=c++17 -O2 bench/correlacao.cpp -o correlacao
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dados.hpp"
+#include "medidas.hpp"
+#include "processo.hpp"
+
+// Resultado do queda para uma amostra: g e as velocidades, com os erros.
+struct Amostra {
+  double g = 0, erro_g = 0;
+  std::vector<double> v, erro_v;
+};
+
+// Le a saida do modo --batch --velocities do queda: uma linha por arquivo,
+// com g e o seu erro na terceira e quarta colunas e as velocidades, como
+// valor:erro separados por virgulas, na ultima. A linha "(fleet)" e pulada.
+std::vector<Amostra> le_saida(std::string const &arquivo) {
+  std::vector<Amostra> amostras;
+  std::ifstream in(arquivo);
+  std::string linha;
+  std::getline(in, linha);
+  while (std::getline(in, linha)) {
+    if (linha.compare(0, 7, "(fleet)") == 0) continue;
+    Amostra a;
+    std::istringstream colunas(linha);
+    std::string coluna;
+    for (int c = 0; std::getline(colunas, coluna, '\t'); ++c) {
+      if (c == 2) a.g = std::stod(coluna);
+      if (c == 3) a.erro_g = std::stod(coluna);
+      if (c == 7) {
+        std::istringstream lista(coluna);
+        std::string v;
+        while (std::getline(lista, v, ',')) {
+          auto dois_pontos = v.find(':');
+          a.v.push_back(std::stod(v.substr(0, dois_pontos)));
+          a.erro_v.push_back(std::stod(v.substr(dois_pontos + 1)));
+        }
+      }
+    }
+    amostras.push_back(a);
+  }
+  return amostras;
+}
+
+// Desvio padrao amostral.
+double desvio(std::vector<double> const &x) {
+  double media = 0, soma = 0;
+  for (auto v: x) media += v;
+  media /= x.size();
+  for (auto v: x) soma += (v - media)*(v - media);
+  return std::sqrt(soma/(x.size() - 1));
+}
+
+int main(int argc, char const *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <queda> [--linhas N] [--amostras K] [--repeticoes R] [--dir D]\n";
+    return 1;
+  }
+  std::string queda = argv[1];
+  std::string dir = "/tmp";
+  size_t linhas = 1000, amostras = 100, repeticoes = 3;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--linhas") linhas = std::stoul(argv[i + 1]);
+    else if (arg == "--amostras") amostras = std::stoul(argv[i + 1]);
+    else if (arg == "--repeticoes") repeticoes = std::stoul(argv[i + 1]);
+    else if (arg == "--dir") dir = argv[i + 1];
+  }
+  if (amostras < 2) amostras = 2;
+
+  std::vector<std::string> entradas;
+  std::string lista = dir + "/bench_correlacao.lista";
+  std::string saida = dir + "/bench_correlacao.out";
+  {
+    std::ofstream manifesto(lista);
+    for (size_t k = 0; k < amostras; ++k) {
+      entradas.push_back(dir + "/bench_correlacao_" + std::to_string(k) + ".dat");
+      std::ofstream out(entradas.back());
+      gera_queda(out, linhas, 1000 + k);
+      manifesto << entradas.back() << "\n";
+    }
+  }
+
+  std::cout << "caso\tp50_us\trss_kb\terro_g\tdispersao_g\trazao_g\trazao_v_p50\n";
+  for (std::string modo: {"independente", "correlacionado"}) {
+    std::vector<std::string> comando = {queda, "--batch", "--threads", "1", "--velocities",
+                                        "--storage", "double", "--accumulate", "double"};
+    if (modo == "correlacionado") comando.push_back("--correlated");
+    comando.insert(comando.end(), {"--manifest", lista, "--output", saida});
+
+    std::vector<double> tempos;
+    long rss_max = 0;
+    bool falhou = false;
+    for (size_t r = 0; r < repeticoes && !falhou; ++r) {
+      long rss;
+      double t = executa(comando, rss);
+      falhou = t < 0;
+      tempos.push_back(t*1e6);
+      rss_max = std::max(rss_max, rss);
+    }
+    auto resultado = le_saida(saida);
+    if (falhou || resultado.size() != amostras) {
+      std::cerr << "Falha executando o modo " << modo << std::endl;
+      continue;
+    }
+
+    std::vector<double> g;
+    double erro_g = 0;
+    for (auto const &a: resultado) {
+      g.push_back(a.g);
+      erro_g += a.erro_g/amostras;
+    }
+    // Razao entre a dispersao e o erro medio de cada velocidade.
+    std::vector<double> razoes_v;
+    for (size_t i = 0; i < resultado[0].v.size(); ++i) {
+      std::vector<double> v;
+      double erro = 0;
+      for (auto const &a: resultado) {
+        v.push_back(a.v[i]);
+        erro += a.erro_v[i]/amostras;
+      }
+      if (erro > 0) razoes_v.push_back(desvio(v)/erro);
+    }
+
+    double dispersao_g = desvio(g);
+    std::cout << "queda_" << modo << "\t" << std::fixed << std::setprecision(3)
+              << percentil(tempos, 50) << "\t" << rss_max << "\t" << std::scientific
+              << std::setprecision(3) << erro_g << "\t" << dispersao_g << "\t"
+              << std::fixed << dispersao_g/erro_g << "\t" << percentil(razoes_v, 50)
+              << std::endl;
+  }
+
+  for (auto const &e: entradas) std::remove(e.c_str());
+  std::remove(lista.c_str());
+  std::remove(saida.c_str());
+  return 0;
+}
@@ -0,0 +1,84 @@
+/*Geradores de dados sinteticos para os benchmarks.
+
+Os dados sao gerados com sementes fixas, entao a mesma chamada produz
+sempre o mesmo arquivo e os resultados podem ser comparados entre commits.
+*/
+
+#ifndef BENCH_DADOS_HPP
+#define BENCH_DADOS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class Distribuicao { normal, uniforme, exponencial, lognormal };
+
+inline Distribuicao distribuicao_por_nome(std::string const &nome) {
+  if (nome == "normal") return Distribuicao::normal;
+  if (nome == "uniforme") return Distribuicao::uniforme;
+  if (nome == "exponencial") return Distribuicao::exponencial;
+  if (nome == "lognormal") return Distribuicao::lognormal;
+  throw std::invalid_argument("Distribuicao desconhecida: " + nome);
+}
+
+// Escreve uma linha de texto ja formatada em os.
+inline void escreve_linha(std::ostream &os, char const *formato, double a) {
+  char linha[64];
+  int n = std::snprintf(linha, sizeof(linha), formato, a);
+  os.write(linha, n);
+}
+
+// Arquivo do estat: um valor por linha.
+inline void gera_estat(std::ostream &os, size_t linhas, Distribuicao dist, std::uint64_t semente) {
+  std::mt19937_64 gen(semente);
+  std::normal_distribution<double> normal(100.0, 15.0);
+  std::uniform_real_distribution<double> uniforme(0.0, 200.0);
+  std::exponential_distribution<double> exponencial(0.01);
+  std::lognormal_distribution<double> lognormal(4.0, 0.5);
+  for (size_t i = 0; i < linhas; ++i) {
+    double x = 0;
+    switch (dist) {
+      case Distribuicao::normal: x = normal(gen); break;
+      case Distribuicao::uniforme: x = uniforme(gen); break;
+      case Distribuicao::exponencial: x = exponencial(gen); break;
+      case Distribuicao::lognormal: x = lognormal(gen); break;
+    }
+    escreve_linha(os, "%.6f\n", x);
+  }
+}
+
+// Arquivo do queda: trajetoria de 10 s de queda livre com g = 9.81, com
+// ruido gaussiano do tamanho dos erros informados em cada linha. Os tempos
+// comecam em inicio; tempos grandes testam a precisao das diferencas.
+inline void gera_queda(std::ostream &os, size_t linhas, std::uint64_t semente, double inicio = 0.5) {
+  std::mt19937_64 gen(semente);
+  double const g = 9.81, erro_t = 0.0005, erro_h = 0.01;
+  double const duracao = 10.0, h0 = 0.5*g*duracao*duracao + 10.0;
+  std::normal_distribution<double> ruido_t(0.0, erro_t);
+  std::normal_distribution<double> ruido_h(0.0, erro_h);
+  for (size_t i = 0; i < linhas; ++i) {
+    double t = duracao*i/linhas;
+    double h = h0 - 0.5*g*(t + 0.5)*(t + 0.5);
+    char linha[128];
+    int n = std::snprintf(linha, sizeof(linha), "%.6f %.6f %.6f %.6f\n",
+                          inicio + t + ruido_t(gen), erro_t, h + ruido_h(gen), erro_h);
+    os.write(linha, n);
+  }
+}
+
+// Chaves inteiras para os OrderedUniqueValues, com cerca de metade de
+// repetidas quando n e grande em relacao a faixa.
+inline std::vector<int> gera_chaves(size_t n, int faixa, std::uint64_t semente) {
+  std::mt19937_64 gen(semente);
+  std::uniform_int_distribution<int> dist(-faixa, faixa);
+  std::vector<int> chaves(n);
+  for (auto &k: chaves) k = dist(gen);
+  return chaves;
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*Harness de benchmark do estat, do queda e dos OrderedUniqueValues.
+
+Gera os dados sinteticos (dados.hpp) em um diretorio, executa cada caso
+varias vezes como um processo separado e imprime uma linha por caso no
+formato de medidas.hpp: vazao em MB/s do arquivo de entrada, percentis do
+tempo de cada execucao e o maior pico de memoria residente dos processos.
+Os benchmarks dos OrderedUniqueValues (ouv.cpp) sao executados uma vez e
+as suas linhas sao repassadas como estao.
+
+Uso: executa [--dir D] [--linhas N] [--repeticoes R] [--threads T]
+             [--estat caminho] [--queda caminho] [--ouv caminho]...
+
+Sem --estat, --queda ou --ouv o caso correspondente e pulado.
+
+Compilar: g++ -std=c++17 -O2 bench/executa.cpp -o executa
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dados.hpp"
+#include "medidas.hpp"
+#include "processo.hpp"
+
+// Executa um caso repeticoes vezes e imprime a medida.
+void caso(std::string const &nome, std::vector<std::string> const &comando,
+          std::string const &entrada, size_t repeticoes) {
+  struct stat st;
+  stat(entrada.c_str(), &st);
+  Medida m{nome, size_t(st.st_size), repeticoes, 0, "MB/s", {}, 0};
+  double total = 0;
+  for (size_t i = 0; i < repeticoes; ++i) {
+    long rss;
+    double t = executa(comando, rss);
+    if (t < 0) {
+      std::cerr << "Falha executando o caso " << nome << std::endl;
+      return;
+    }
+    total += t;
+    m.latencias_us.push_back(t*1e6);
+    m.rss_kb = std::max(m.rss_kb, rss);
+  }
+  m.vazao = m.tamanho/1e6/(total/repeticoes);
+  imprime(std::cout, m);
+}
+
+// Repassa as linhas de resultado de um benchmark ouv, sem o cabecalho.
+void repassa_ouv(std::string const &caminho) {
+  FILE *saida = popen((caminho + " 2>/dev/null").c_str(), "r");
+  if (!saida) return;
+  char linha[512];
+  bool cabecalho = true;
+  while (std::fgets(linha, sizeof(linha), saida)) {
+    if (!cabecalho) std::cout << linha;
+    cabecalho = false;
+  }
+  pclose(saida);
+}
+
+int main(int argc, char const *argv[]) {
+  std::string dir = "/tmp";
+  size_t linhas = 1000000, repeticoes = 5;
+  std::string threads = "4";
+  std::string estat, queda;
+  std::vector<std::string> ouvs;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--dir") dir = argv[i + 1];
+    else if (arg == "--linhas") linhas = std::stoul(argv[i + 1]);
+    else if (arg == "--repeticoes") repeticoes = std::stoul(argv[i + 1]);
+    else if (arg == "--threads") threads = argv[i + 1];
+    else if (arg == "--estat") estat = argv[i + 1];
+    else if (arg == "--queda") queda = argv[i + 1];
+    else if (arg == "--ouv") ouvs.push_back(argv[i + 1]);
+  }
+
+  imprime_cabecalho(std::cout);
+
+  if (!estat.empty()) {
+    std::string arquivo = dir + "/bench_estat.dat";
+    {
+      std::ofstream out(arquivo);
+      gera_estat(out, linhas, Distribuicao::normal, 42);
+    }
+    caso("estat", {estat, arquivo, "100"}, arquivo, repeticoes);
+    caso("estat_stream", {estat, arquivo, "100", "--stream"}, arquivo, repeticoes);
+    caso("estat_threads", {estat, arquivo, "100", "--threads", threads}, arquivo, repeticoes);
+    caso("estat_sketch", {estat, arquivo, "100", "--sketch"}, arquivo, repeticoes);
+    std::remove(arquivo.c_str());
+  }
+
+  if (!queda.empty()) {
+    std::string arquivo = dir + "/bench_queda.dat";
+    {
+      std::ofstream out(arquivo);
+      gera_queda(out, linhas, 42);
+    }
+    caso("queda", {queda, arquivo}, arquivo, repeticoes);
+    caso("queda_stream", {queda, "--stream", arquivo}, arquivo, repeticoes);
+    std::remove(arquivo.c_str());
+  }
+
+  for (auto const &ouv: ouvs) repassa_ouv(ouv);
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+/*Gera arquivos de dados sinteticos para o estat e o queda.
+
+Uso: gera_dados <estat|queda> <linhas> <saida> [--dist normal|uniforme|exponencial|lognormal] [--semente S]
+                  [--inicio T]
+
+--inicio e o tempo da primeira linha do queda (padrao 0.5 s).
+
+Compilar: g++ -std=c++17 -O2 bench/gera_dados.cpp -o gera_dados
+*/
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "dados.hpp"
+
+int main(int argc, char const *argv[]) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <estat|queda> <lines> <output> [--dist name] [--semente S] [--inicio T]\n";
+    return 1;
+  }
+
+  std::string programa = argv[1];
+  size_t linhas = std::stoul(argv[2]);
+  Distribuicao dist = Distribuicao::normal;
+  std::uint64_t semente = 42;
+  double inicio = 0.5;
+  for (int i = 4; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--dist" && i + 1 < argc) dist = distribuicao_por_nome(argv[++i]);
+    else if (arg == "--semente" && i + 1 < argc) semente = std::stoull(argv[++i]);
+    else if (arg == "--inicio" && i + 1 < argc) inicio = std::stod(argv[++i]);
+  }
+
+  std::ofstream saida(argv[3]);
+  if (programa == "estat") gera_estat(saida, linhas, dist, semente);
+  else if (programa == "queda") gera_queda(saida, linhas, semente, inicio);
+  else {
+    std::cerr << "Programa desconhecido: " << programa << std::endl;
+    return 1;
+  }
+  if (!saida) {
+    std::cerr << "Error writing " << argv[3] << std::endl;
+    return 2;
+  }
+
+  return 0;
+}
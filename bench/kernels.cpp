@@ -0,0 +1,135 @@
+/*Microbenchmark e verificacao dos kernels de tarefa1/kernels.hpp.
+
+Para cada implementacao disponivel na CPU (escalar, avx2, avx512) compara os
+resultados com os lacos originais de estat_data e box_histogram (pow e floor
+por elemento) e mede o tempo de cada kernel. Verifica tambem que min_max trata
+NaN como a versao escalar. Termina com codigo 1 se algum resultado nao bater.
+
+Uso: kernels [numero de valores] [numero de caixas]
+Compilar: g++ -std=c++17 -O2 bench/kernels.cpp -o kernels
+*/
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../tarefa1/kernels.hpp"
+
+// Lacos originais de estat_data e box_histogram, usados como referencia.
+struct Referencia {
+  double mean, stdev, min, max;
+  std::vector<int> k;
+};
+
+Referencia referencia(std::vector<double> const &data, int B) {
+  Referencia r{0, 0, data[0], data[0], std::vector<int>(data.size())};
+  for (auto x: data) r.mean += x;
+  r.mean /= data.size();
+  for (auto x: data) r.stdev += pow(x - r.mean, 2);
+  r.stdev = pow(r.stdev/(data.size() - 1), 0.5);
+  for (auto x: data) {
+    if (r.max < x) r.max = x;
+    if (r.min > x) r.min = x;
+  }
+  double box_size = (r.max - r.min)/B;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (data[i] != r.max) r.k[i] = floor((data[i] - r.min)/box_size);
+    else r.k[i] = B - 1;
+  }
+  return r;
+}
+
+template<typename F>
+double mede(int repeticoes, F f) {
+  auto inicio = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeticoes; ++i) f();
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - inicio;
+  return dt.count()/repeticoes;
+}
+
+double erro_relativo(double a, double b) {
+  return std::fabs(a - b)/std::fabs(b);
+}
+
+// Iguais, ou os dois NaN.
+bool mesmo_valor(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+// Compara min_max de impl com o da versao escalar com um NaN em cada posicao
+// (no primeiro valor, nos blocos vetoriais e no resto) e com todos NaN.
+bool verifica_nan(Kernels const &impl) {
+  double const nan = std::nan("");
+  std::vector<double> x(19);
+  bool ok = true;
+  for (size_t p = 0; p <= x.size(); ++p) {
+    for (size_t i = 0; i < x.size(); ++i) x[i] = p == x.size() ? nan : double(i % 7) - 3;
+    if (p < x.size()) x[p] = nan;
+    double min, max, min_ref, max_ref;
+    impl.min_max(x.data(), x.size(), min, max);
+    kernels_escalares().min_max(x.data(), x.size(), min_ref, max_ref);
+    if (!mesmo_valor(min, min_ref) || !mesmo_valor(max, max_ref)) {
+      std::cerr << "min_max com NaN na posicao " << p << " diferente da versao escalar em "
+                << impl.nome << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char const *argv[]) {
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 10000000;
+  int B = argc > 2 ? std::stoi(argv[2]) : 100;
+
+  // Valores com media grande em relacao ao desvio, o caso mais sensivel ao
+  // arredondamento, e um tamanho que nao e multiplo de 8 para testar o resto.
+  std::vector<double> data(n + 3);
+  std::mt19937_64 gen(42);
+  std::normal_distribution<double> dist(1000.0, 2.0);
+  for (auto &x: data) x = dist(gen);
+
+  auto ref = referencia(data, B);
+  double const tolerancia = 1e-12;
+  bool ok = true;
+
+  std::vector<Kernels const *> impls{&kernels_escalares()};
+  if (kernels_avx2_se_houver()) impls.push_back(kernels_avx2_se_houver());
+  if (kernels_avx512_se_houver()) impls.push_back(kernels_avx512_se_houver());
+
+  std::cout << "kernel soma_s desvios_s min_max_s indices_s erro_mean erro_stdev\n";
+  std::vector<int> k(data.size());
+  for (auto impl: impls) {
+    double mean = impl->soma(data.data(), data.size())/data.size();
+    double stdev = std::sqrt(impl->soma_desvios(data.data(), data.size(), mean)/(data.size() - 1));
+    double min, max;
+    impl->min_max(data.data(), data.size(), min, max);
+    double box_size = (max - min)/B;
+    impl->indices_caixas(data.data(), data.size(), min, max, box_size, B, k.data());
+
+    double em = erro_relativo(mean, ref.mean);
+    double es = erro_relativo(stdev, ref.stdev);
+    if (em > tolerancia || es > tolerancia || min != ref.min || max != ref.max || k != ref.k) {
+      std::cerr << "Resultado diferente da referencia em " << impl->nome << std::endl;
+      ok = false;
+    }
+    if (!verifica_nan(*impl)) ok = false;
+
+    double volatile sink;
+    double t_soma = mede(10, [&] { sink = impl->soma(data.data(), data.size()); });
+    double t_desv = mede(10, [&] { sink = impl->soma_desvios(data.data(), data.size(), mean); });
+    double t_mm = mede(10, [&] { impl->min_max(data.data(), data.size(), min, max); });
+    double t_idx = mede(10, [&] {
+      impl->indices_caixas(data.data(), data.size(), min, max, box_size, B, k.data());
+    });
+    (void)sink;
+
+    std::cout << impl->nome << " " << t_soma << " " << t_desv << " " << t_mm << " "
+              << t_idx << " " << em << " " << es << std::endl;
+  }
+
+  std::cout << "dispatch: " << kernels().nome << std::endl;
+  return ok ? 0 : 1;
+}
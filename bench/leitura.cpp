@@ -0,0 +1,95 @@
+/*Benchmark da leitura de numeros: std::ifstream >> double (caminho antigo de
+read_file e Positions::read_data) contra o arquivo mapeado com
+std::from_chars de comum/leitura.hpp.
+
+Uso: leitura [diretorio] [tamanhos em MB...]
+Sem tamanhos usa 10 100 1000. Para 10 GB passe 10240.
+Os arquivos sao gerados no diretorio (padrao /tmp) e apagados no final.
+
+Compilar: g++ -std=c++17 -O2 bench/leitura.cpp -o leitura
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../comum/leitura.hpp"
+
+// Gera um arquivo com uma coluna de valores com aproximadamente mb megabytes.
+void gera_arquivo(std::string const &nome, size_t mb) {
+  std::ofstream out(nome);
+  std::mt19937_64 gen(42);
+  std::normal_distribution<double> dist(10.0, 3.0);
+  size_t const alvo = mb * 1024 * 1024;
+  size_t escritos = 0;
+  char linha[32];
+  while (escritos < alvo) {
+    int n = std::snprintf(linha, sizeof(linha), "%10.4f\n", dist(gen));
+    out.write(linha, n);
+    escritos += n;
+  }
+}
+
+// Caminho antigo: operator>> do ifstream.
+double soma_ifstream(std::string const &nome, size_t &n) {
+  std::ifstream file(nome);
+  double val, soma = 0;
+  n = 0;
+  while (file >> val) {
+    soma += val;
+    ++n;
+  }
+  return soma;
+}
+
+// Caminho novo: mmap + from_chars.
+double soma_mapeado(std::string const &nome, size_t &n) {
+  ArquivoMapeado file(nome);
+  LeitorNumeros leitor(file.conteudo());
+  double val, soma = 0;
+  n = 0;
+  while (leitor.proximo(val)) {
+    soma += val;
+    ++n;
+  }
+  return soma;
+}
+
+template<typename F>
+double mede(F f) {
+  auto inicio = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - inicio;
+  return dt.count();
+}
+
+int main(int argc, char const *argv[]) {
+  std::string dir = argc > 1 ? argv[1] : "/tmp";
+  std::vector<size_t> tamanhos;
+  for (int i = 2; i < argc; ++i) tamanhos.push_back(std::stoul(argv[i]));
+  if (tamanhos.empty()) tamanhos = {10, 100, 1000};
+
+  std::cout << "MB ifstream_s mmap_s ifstream_MB/s mmap_MB/s aceleracao\n";
+  for (auto mb : tamanhos) {
+    std::string nome = dir + "/bench_leitura_" + std::to_string(mb) + ".dat";
+    gera_arquivo(nome, mb);
+
+    size_t n1, n2;
+    double s1 = 0, s2 = 0;
+    double t1 = mede([&] { s1 = soma_ifstream(nome, n1); });
+    double t2 = mede([&] { s2 = soma_mapeado(nome, n2); });
+    if (n1 != n2 || s1 != s2) {
+      std::cerr << "Resultados diferentes para " << nome << std::endl;
+    }
+
+    std::cout << mb << " " << t1 << " " << t2 << " " << mb / t1 << " "
+              << mb / t2 << " " << t1 / t2 << std::endl;
+    std::remove(nome.c_str());
+  }
+
+  return 0;
+}
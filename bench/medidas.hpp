@@ -0,0 +1,81 @@
+/*Formato comum dos resultados dos benchmarks.
+
+Cada caso gera uma linha separada por tabulacoes, sempre com as mesmas
+colunas e na mesma ordem, para que a saida de dois commits possa ser
+comparada linha a linha:
+
+  caso  tamanho  repeticoes  vazao  unidade  p50_us  p95_us  p99_us  rss_kb
+
+As latencias sao percentis (pelo posto mais proximo) das amostras do caso e
+rss_kb e o pico de memoria residente do processo que executou o caso. Nos
+casos medidos no proprio processo do benchmark o pico e reiniciado no inicio
+de cada caso (reinicia_rss_pico), entao inclui a memoria que o processo ja
+ocupava, como os dados de entrada, mas nao os picos dos casos anteriores.
+*/
+
+#ifndef BENCH_MEDIDAS_HPP
+#define BENCH_MEDIDAS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+struct Medida {
+  std::string caso;
+  size_t tamanho;
+  size_t repeticoes;
+  double vazao;
+  std::string unidade;
+  std::vector<double> latencias_us;
+  long rss_kb;
+};
+
+// Percentil p (0 a 100) pelo posto mais proximo.
+inline double percentil(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t posto = size_t(std::ceil(p/100*v.size()));
+  return v[posto > 0 ? posto - 1 : 0];
+}
+
+// Reinicia o pico de memoria residente deste processo (no Linux, escrevendo 5
+// em /proc/self/clear_refs) para o pico medido ser so o do caso seguinte.
+inline void reinicia_rss_pico() {
+  std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+// Pico de memoria residente deste processo desde o ultimo reinicia_rss_pico,
+// em kB (VmHWM em /proc/self/status). Sem /proc, o pico desde o inicio do
+// processo.
+inline long rss_pico_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string campo;
+  long kb;
+  while (status >> campo) {
+    if (campo == "VmHWM:" && status >> kb) return kb;
+  }
+  rusage uso;
+  getrusage(RUSAGE_SELF, &uso);
+  return uso.ru_maxrss;
+}
+
+inline void imprime_cabecalho(std::ostream &os) {
+  os << "caso\ttamanho\trepeticoes\tvazao\tunidade\tp50_us\tp95_us\tp99_us\trss_kb\n";
+}
+
+inline void imprime(std::ostream &os, Medida const &m) {
+  os << std::fixed << std::setprecision(3)
+     << m.caso << "\t" << m.tamanho << "\t" << m.repeticoes << "\t" << m.vazao << "\t"
+     << m.unidade << "\t" << percentil(m.latencias_us, 50) << "\t"
+     << percentil(m.latencias_us, 95) << "\t" << percentil(m.latencias_us, 99) << "\t"
+     << m.rss_kb << std::endl;
+}
+
+#endif
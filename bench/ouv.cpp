@@ -0,0 +1,84 @@
+/*Benchmark dos OrderedUniqueValues das tarefas 3 e 4.
+
+Executa cargas fixas de insert, find e find_range sobre chaves inteiras
+aleatorias e, por fim, uma carga mista (misto) em que cada operacao e um
+insert de uma chave nova seguido de um find. Imprime os resultados no
+formato de medidas.hpp. As latencias sao medidas em lotes de 1000 operacoes
+e divididas pelo tamanho do lote.
+
+Uso: ouv [numero de chaves]
+Compilar:
+  g++ -std=c++17 -O2 -DTAREFA3 bench/ouv.cpp -o ouv_t3
+  g++ -std=c++17 -O2 bench/ouv.cpp -o ouv_t4
+  g++ -std=c++17 -O2 -DBUFFERED bench/ouv.cpp -o ouv_t4_buffered
+*/
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dados.hpp"
+#include "medidas.hpp"
+
+#ifdef TAREFA3
+#include "../tarefa3/ordered_unique_values.hpp"
+using Conjunto = OrderedUniqueValues;
+char const *const prefixo = "t3";
+#elif defined(BUFFERED)
+#include "../tarefa4/buffered_ordered_unique_values.hpp"
+using Conjunto = BufferedOrderedUniqueValues<int>;
+char const *const prefixo = "t4_buffered";
+#else
+#include "../tarefa4/ordered_unique_values.hpp"
+using Conjunto = OrderedUniqueValues<int>;
+char const *const prefixo = "t4";
+#endif
+
+size_t const lote = 1000;
+
+// Executa op(i) para i em [0, n) em lotes, medindo cada lote.
+template<typename F>
+Medida mede(std::string const &caso, size_t n, F op) {
+  Medida m{std::string(prefixo) + "_" + caso, n, 1, 0, "ops/s", {}, 0};
+  reinicia_rss_pico();
+  auto inicio = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i += lote) {
+    auto t0 = std::chrono::steady_clock::now();
+    size_t fim = std::min(n, i + lote);
+    for (size_t j = i; j < fim; ++j) op(j);
+    std::chrono::duration<double, std::micro> dt = std::chrono::steady_clock::now() - t0;
+    m.latencias_us.push_back(dt.count()/(fim - i));
+  }
+  std::chrono::duration<double> total = std::chrono::steady_clock::now() - inicio;
+  m.vazao = n/total.count();
+  m.rss_kb = rss_pico_kb();
+  return m;
+}
+
+int main(int argc, char const *argv[]) {
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 100000;
+  int faixa = int(n);
+  auto chaves = gera_chaves(n, faixa, 42);
+  auto consultas = gera_chaves(n, faixa, 43);
+  auto novas = gera_chaves(n, faixa, 44);
+
+  Conjunto conjunto;
+  size_t achados = 0;
+
+  imprime_cabecalho(std::cout);
+  imprime(std::cout, mede("insert", n, [&](size_t i) { conjunto.insert(chaves[i]); }));
+  imprime(std::cout, mede("find", n, [&](size_t i) { achados += conjunto.find(consultas[i]); }));
+  imprime(std::cout, mede("find_range", n/10, [&](size_t i) {
+    auto [first, last] = conjunto.find_range(consultas[i], consultas[i] + 100);
+    achados += last - first;
+  }));
+  imprime(std::cout, mede("misto", n, [&](size_t i) {
+    conjunto.insert(novas[i]);
+    achados += conjunto.find(consultas[i]);
+  }));
+
+  // usa o resultado para o compilador nao eliminar as buscas
+  std::cerr << "achados: " << achados << std::endl;
+  return 0;
+}
@@ -0,0 +1,141 @@
+/*Benchmark das precisoes do queda (--storage e --accumulate).
+
+Gera uma trajetoria de --linhas pontos (padrao 100000) com o primeiro tempo
+em --inicio (padrao 1000 s, onde a distancia entre dois floats vizinhos ja
+e de 6e-5 s) e executa o queda --batch --velocities com cada combinacao de
+armazenamento e acumulacao. Para cada uma imprime, separados por
+tabulacoes:
+
+  caso  armazenamento  acumulacao  p50_us  rss_kb  erro_g  erro_v_p50  erro_v_p99  v_invalidas
+
+p50_us e a mediana do tempo das execucoes e rss_kb o maior pico de memoria
+residente. Os erros sao relativos a execucao em double/double: erro_g e a
+diferenca relativa em g, erro_v_p50 e erro_v_p99 sao percentis da
+diferenca relativa das velocidades e v_invalidas conta as velocidades que
+ficaram infinitas ou NaN (tempos vizinhos iguais na precisao usada) onde a
+referencia e finita.
+
+Uso: precisao <caminho do queda> [--linhas N] [--repeticoes R] [--inicio T] [--dir D]
+Compilar: g++ -std=c++17 -O2 bench/precisao.cpp -o precisao
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dados.hpp"
+#include "medidas.hpp"
+#include "processo.hpp"
+
+// Resultado de uma execucao do queda: g e os valores das velocidades.
+struct SaidaQueda {
+  double g = 0;
+  std::vector<double> velocidades;
+};
+
+// Le a saida do modo --batch --velocities do queda, que tem mais digitos que
+// a do modo normal: a linha do arquivo tem g na terceira coluna e as
+// velocidades, como valor:erro separados por virgulas, na ultima.
+SaidaQueda le_saida(std::string const &arquivo) {
+  SaidaQueda s;
+  std::ifstream in(arquivo);
+  std::string linha;
+  std::getline(in, linha);
+  if (!std::getline(in, linha)) return s;
+  std::istringstream colunas(linha);
+  std::string coluna;
+  for (int c = 0; std::getline(colunas, coluna, '\t'); ++c) {
+    if (c == 2) s.g = std::stod(coluna);
+    if (c == 7) {
+      std::istringstream lista(coluna);
+      std::string v;
+      while (std::getline(lista, v, ',')) s.velocidades.push_back(std::stod(v));
+    }
+  }
+  return s;
+}
+
+int main(int argc, char const *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <queda> [--linhas N] [--repeticoes R] [--inicio T] [--dir D]\n";
+    return 1;
+  }
+  std::string queda = argv[1];
+  std::string dir = "/tmp";
+  size_t linhas = 100000, repeticoes = 3;
+  double inicio = 1000;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--linhas") linhas = std::stoul(argv[i + 1]);
+    else if (arg == "--repeticoes") repeticoes = std::stoul(argv[i + 1]);
+    else if (arg == "--inicio") inicio = std::stod(argv[i + 1]);
+    else if (arg == "--dir") dir = argv[i + 1];
+  }
+
+  std::string entrada = dir + "/bench_precisao.dat";
+  std::string saida = dir + "/bench_precisao.out";
+  {
+    std::ofstream out(entrada);
+    gera_queda(out, linhas, 42, inicio);
+  }
+
+  // A referencia e a primeira combinacao.
+  std::vector<std::pair<std::string, std::string>> combinacoes = {
+      {"double", "double"}, {"double", "float"}, {"float", "double"},
+      {"float", "float"},   {"half", "double"},  {"half", "float"}};
+  SaidaQueda referencia;
+
+  std::cout << "caso\tarmazenamento\tacumulacao\tp50_us\trss_kb\terro_g\terro_v_p50\terro_v_p99\tv_invalidas\n";
+  for (auto const &[armazenamento, acumulacao]: combinacoes) {
+    std::vector<std::string> comando = {queda, "--batch", "--threads", "1", "--velocities",
+                                        "--storage", armazenamento, "--accumulate",
+                                        acumulacao, entrada};
+    std::vector<double> tempos;
+    long rss_max = 0;
+    bool falhou = false;
+    for (size_t r = 0; r < repeticoes && !falhou; ++r) {
+      long rss;
+      double t = executa(comando, rss, saida);
+      falhou = t < 0;
+      tempos.push_back(t*1e6);
+      rss_max = std::max(rss_max, rss);
+    }
+    if (falhou) {
+      std::cerr << "Falha executando " << armazenamento << "/" << acumulacao << std::endl;
+      continue;
+    }
+
+    auto resultado = le_saida(saida);
+    if (referencia.velocidades.empty()) referencia = resultado;
+    // Velocidades de referencia nulas ou infinitas ficam de fora.
+    std::vector<double> erros;
+    size_t invalidas = 0;
+    for (size_t i = 0; i < std::min(resultado.velocidades.size(), referencia.velocidades.size()); ++i) {
+      double ref = referencia.velocidades[i];
+      if (!std::isfinite(ref) || ref == 0) continue;
+      if (!std::isfinite(resultado.velocidades[i])) {
+        ++invalidas;
+        continue;
+      }
+      erros.push_back(std::fabs(resultado.velocidades[i] - ref)/std::fabs(ref));
+    }
+
+    std::cout << std::defaultfloat << "queda_" << armazenamento << "_" << acumulacao << "\t"
+              << armazenamento << "\t" << acumulacao << "\t" << std::fixed
+              << std::setprecision(3) << percentil(tempos, 50) << "\t" << rss_max << "\t"
+              << std::scientific << std::setprecision(3)
+              << std::fabs(resultado.g - referencia.g)/std::fabs(referencia.g) << "\t"
+              << percentil(erros, 50) << "\t" << percentil(erros, 99) << "\t" << invalidas
+              << std::endl;
+  }
+
+  std::remove(entrada.c_str());
+  std::remove(saida.c_str());
+  return 0;
+}
@@ -0,0 +1,46 @@
+/*Execucao de um programa como processo separado, para os benchmarks que
+medem os executaveis (executa.cpp, precisao.cpp).
+*/
+
+#ifndef BENCH_PROCESSO_HPP
+#define BENCH_PROCESSO_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Executa o comando com a saida de erros descartada e a saida padrao em
+// saida (descartada se nao for dada). Retorna o tempo em segundos e o pico de
+// memoria residente do processo em rss_kb, ou -1 se ele falhou.
+inline double executa(std::vector<std::string> const &comando, long &rss_kb,
+                      std::string const &saida = "/dev/null") {
+  std::vector<char *> argv;
+  for (auto const &a: comando) argv.push_back(const_cast<char *>(a.c_str()));
+  argv.push_back(nullptr);
+
+  auto inicio = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    int nulo = open("/dev/null", O_WRONLY);
+    int out = open(saida.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(out, STDOUT_FILENO);
+    dup2(nulo, STDERR_FILENO);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  int status;
+  rusage uso;
+  wait4(pid, &status, 0, &uso);
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - inicio;
+
+  rss_kb = uso.ru_maxrss;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+  return dt.count();
+}
+
+#endif
@@ -0,0 +1,198 @@
+/*Formato binario colunar para os arquivos de dados do estat e do queda.
+
+O arquivo comeca com um cabecalho de 64 bytes:
+
+  magica[8]    "POOCOL1" terminado em '\0'
+  esquema      uint32: 1 = estat (valor), 2 = queda (tempo, erro do tempo,
+               altura, erro da altura)
+  tipo         uint32: 1 = float32, 2 = float64
+  linhas       uint64: numero de valores em cada coluna
+  colunas      uint32: numero de colunas do esquema
+  reservado    ate completar 64 bytes, zerado
+
+Depois vem uma coluna inteira apos a outra, cada uma comecando em um
+multiplo de 64 bytes, com os valores em little-endian. O arquivo e mapeado
+na memoria e lido direto, sem nenhuma conversao de texto.
+
+O conversor de texto para este formato e comum/converte.cpp.
+*/
+
+#ifndef COMUM_COLUNAR_HPP
+#define COMUM_COLUNAR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Erro de estrutura em um arquivo binario colunar (cabecalho invalido,
+// arquivo truncado, esquema diferente do esperado) ou em um sketch salvo
+// (tarefa1/sketch.hpp).
+class ErroFormato : public std::runtime_error {
+  public:
+    explicit ErroFormato(std::string const &msg) : std::runtime_error(msg) {}
+};
+
+enum class Esquema : std::uint32_t { estat = 1, queda = 2 };
+enum class TipoDado : std::uint32_t { float32 = 1, float64 = 2 };
+
+struct CabecalhoColunar {
+  char magica[8];
+  std::uint32_t esquema;
+  std::uint32_t tipo;
+  std::uint64_t linhas;
+  std::uint32_t colunas;
+  std::uint8_t reservado[36];
+};
+static_assert(sizeof(CabecalhoColunar) == 64, "cabecalho deve ter 64 bytes");
+
+constexpr char magica_colunar[8] = "POOCOL1";
+constexpr size_t alinhamento_colunar = 64;
+
+// Numero de colunas de cada esquema.
+inline std::uint32_t colunas_do_esquema(Esquema e) {
+  return e == Esquema::queda ? 4 : 1;
+}
+
+inline size_t tamanho_do_tipo(TipoDado t) {
+  return t == TipoDado::float32 ? 4 : 8;
+}
+
+// O formato e little-endian e os valores sao lidos direto da memoria.
+inline bool maquina_little_endian() {
+  std::uint16_t x = 1;
+  unsigned char c;
+  std::memcpy(&c, &x, 1);
+  return c == 1;
+}
+
+// Verifica se o conteudo de um arquivo esta no formato colunar.
+inline bool e_colunar(std::string_view conteudo) {
+  return conteudo.size() >= sizeof(CabecalhoColunar) &&
+         std::memcmp(conteudo.data(), magica_colunar, sizeof(magica_colunar)) == 0;
+}
+
+// Visao de um arquivo colunar ja mapeado na memoria.
+class ArquivoColunar {
+  CabecalhoColunar _cabecalho;
+  char const *_base;
+  size_t _bytes_coluna;
+
+  public:
+    explicit ArquivoColunar(std::string_view conteudo) : _base{conteudo.data()} {
+      if (!e_colunar(conteudo)) throw ErroFormato("Arquivo nao e colunar");
+      if (!maquina_little_endian()) {
+        throw ErroFormato("Formato colunar so e suportado em maquinas little-endian");
+      }
+      std::memcpy(&_cabecalho, conteudo.data(), sizeof(_cabecalho));
+      if ((_cabecalho.tipo != std::uint32_t(TipoDado::float32) &&
+           _cabecalho.tipo != std::uint32_t(TipoDado::float64)) ||
+          (_cabecalho.esquema != std::uint32_t(Esquema::estat) &&
+           _cabecalho.esquema != std::uint32_t(Esquema::queda)) ||
+          _cabecalho.colunas != colunas_do_esquema(esquema())) {
+        throw ErroFormato("Cabecalho colunar invalido");
+      }
+      if (_cabecalho.linhas > conteudo.size()) throw ErroFormato("Arquivo colunar truncado");
+      _bytes_coluna = bytes_da_coluna(_cabecalho.linhas, tipo());
+      if (conteudo.size() < sizeof(_cabecalho) + _cabecalho.colunas*_bytes_coluna) {
+        throw ErroFormato("Arquivo colunar truncado");
+      }
+    }
+
+    // Bytes ocupados por uma coluna, incluindo o preenchimento ate 64 bytes.
+    static size_t bytes_da_coluna(std::uint64_t linhas, TipoDado t) {
+      size_t bytes = linhas*tamanho_do_tipo(t);
+      return (bytes + alinhamento_colunar - 1)/alinhamento_colunar*alinhamento_colunar;
+    }
+
+    Esquema esquema() const { return Esquema(_cabecalho.esquema); }
+    TipoDado tipo() const { return TipoDado(_cabecalho.tipo); }
+    size_t linhas() const { return _cabecalho.linhas; }
+    std::uint32_t colunas() const { return _cabecalho.colunas; }
+
+    // Inicio dos dados da coluna c.
+    char const *coluna(std::uint32_t c) const {
+      return _base + sizeof(_cabecalho) + c*_bytes_coluna;
+    }
+
+    // Valores da coluna c lidos direto da memoria, sem copia, ou nullptr se
+    // a coluna nao e float64 ou os dados nao estao alinhados para double.
+    double const *coluna_double(std::uint32_t c) const {
+      if (tipo() != TipoDado::float64) return nullptr;
+      char const *p = coluna(c);
+      if (reinterpret_cast<std::uintptr_t>(p) % alignof(double) != 0) return nullptr;
+      return reinterpret_cast<double const *>(p);
+    }
+
+    // Valor da linha i da coluna c, convertido para T.
+    template<typename T>
+    T valor(std::uint32_t c, size_t i) const {
+      if (tipo() == TipoDado::float32) {
+        float x;
+        std::memcpy(&x, coluna(c) + i*sizeof(float), sizeof(float));
+        return T(x);
+      }
+      double x;
+      std::memcpy(&x, coluna(c) + i*sizeof(double), sizeof(double));
+      return T(x);
+    }
+};
+
+// Percorre as linhas [inicio, fim) de uma coluna, com a mesma interface de
+// LeitorNumeros para que o codigo de leitura sirva para os dois formatos.
+class LeitorColuna {
+  ArquivoColunar const &_arquivo;
+  std::uint32_t _coluna;
+  size_t _pos;
+  size_t _fim;
+
+  public:
+    LeitorColuna(ArquivoColunar const &arquivo, std::uint32_t coluna, size_t inicio, size_t fim)
+        : _arquivo{arquivo}, _coluna{coluna}, _pos{inicio}, _fim{fim} {}
+
+    template<typename T>
+    bool proximo(T &valor) {
+      if (_pos == _fim) return false;
+      valor = _arquivo.valor<T>(_coluna, _pos++);
+      return true;
+    }
+};
+
+// Escreve as colunas no formato colunar. Todas as colunas devem ter o mesmo
+// numero de valores.
+inline void escreve_colunar(std::ostream &os, Esquema esquema, TipoDado tipo,
+                            std::vector<std::vector<double>> const &colunas) {
+  if (!maquina_little_endian()) {
+    throw ErroFormato("Formato colunar so e suportado em maquinas little-endian");
+  }
+  CabecalhoColunar cabecalho{};
+  std::memcpy(cabecalho.magica, magica_colunar, sizeof(magica_colunar));
+  cabecalho.esquema = std::uint32_t(esquema);
+  cabecalho.tipo = std::uint32_t(tipo);
+  cabecalho.linhas = colunas.empty() ? 0 : colunas[0].size();
+  cabecalho.colunas = colunas_do_esquema(esquema);
+  if (colunas.size() != cabecalho.colunas) throw ErroFormato("Numero de colunas errado");
+  os.write(reinterpret_cast<char const *>(&cabecalho), sizeof(cabecalho));
+
+  size_t bytes = ArquivoColunar::bytes_da_coluna(cabecalho.linhas, tipo);
+  std::vector<char> buffer(bytes);
+  for (auto const &col: colunas) {
+    std::fill(buffer.begin(), buffer.end(), 0);
+    for (size_t i = 0; i < col.size(); ++i) {
+      if (tipo == TipoDado::float32) {
+        float x = float(col[i]);
+        std::memcpy(buffer.data() + i*sizeof(float), &x, sizeof(float));
+      } else {
+        std::memcpy(buffer.data() + i*sizeof(double), &col[i], sizeof(double));
+      }
+    }
+    os.write(buffer.data(), buffer.size());
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*Converte um arquivo de dados em texto do estat ou do queda para o formato
+binario colunar de colunar.hpp.
+
+Uso: converte <estat|queda> <entrada> <saida> [--float32|--float64]
+
+O tipo padrao e float64 para o estat e float32 para o queda, que sao os
+tipos com que cada programa faz as contas.
+
+Compilar: g++ -std=c++17 -O2 comum/converte.cpp -o converte
+*/
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "colunar.hpp"
+#include "leitura.hpp"
+
+void usage(std::string exename) {
+  std::cerr << "Usage: " << exename
+            << " <estat|queda> <input file> <output file> [--float32|--float64]\n";
+}
+
+int main(int argc, char const *argv[]) {
+  if (argc < 4 || argc > 5) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::string nome_esquema = argv[1];
+  if (nome_esquema != "estat" && nome_esquema != "queda") {
+    usage(argv[0]);
+    return 1;
+  }
+  Esquema esquema = nome_esquema == "queda" ? Esquema::queda : Esquema::estat;
+  TipoDado tipo = esquema == Esquema::queda ? TipoDado::float32 : TipoDado::float64;
+  if (argc == 5) {
+    std::string opcao = argv[4];
+    if (opcao == "--float32") tipo = TipoDado::float32;
+    else if (opcao == "--float64") tipo = TipoDado::float64;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Os valores do texto sao distribuidos pelas colunas na ordem em que
+  // aparecem: no queda cada linha tem tempo, erro, altura e erro.
+  std::vector<std::vector<double>> colunas(colunas_do_esquema(esquema));
+  try {
+    ArquivoMapeado entrada(argv[2]);
+    LeitorNumeros leitor(entrada.conteudo());
+    double x;
+    size_t i = 0;
+    while (leitor.proximo(x)) {
+      colunas[i++ % colunas.size()].push_back(x);
+    }
+    if (i % colunas.size() != 0) {
+      std::cerr << "Error reading data from " << argv[2]
+                << ": incomplete line " << leitor.linha() << std::endl;
+      return 3;
+    }
+  } catch (std::system_error const &e) {
+    std::cerr << "Error reading " << argv[2] << std::endl;
+    return 2;
+  } catch (ErroLeitura const &e) {
+    std::cerr << "Error reading data from " << argv[2] << ": " << e.what() << std::endl;
+    return 3;
+  }
+
+  std::ofstream saida(argv[3], std::ios::binary);
+  escreve_colunar(saida, esquema, tipo, colunas);
+  if (!saida) {
+    std::cerr << "Error writing " << argv[3] << std::endl;
+    return 2;
+  }
+
+  return 0;
+}
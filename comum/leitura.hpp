@@ -0,0 +1,325 @@
+/*Camada de leitura compartilhada pelos programas das tarefas.
+
+O arquivo de entrada e mapeado na memoria (mmap) e os numeros sao
+convertidos com std::from_chars direto do texto mapeado, sem copias e sem
+passar pelo caminho dependente de locale do operator>> dos streams.
+*/
+
+#ifndef COMUM_LEITURA_HPP
+#define COMUM_LEITURA_HPP
+
+#include <charconv>
+#include <cerrno>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Erro de conversao de um token, com a linha e a coluna (a partir de 1) onde
+// o token comeca.
+class ErroLeitura : public std::runtime_error {
+  size_t _linha;
+  size_t _coluna;
+
+  public:
+    ErroLeitura(std::string const &msg, size_t linha, size_t coluna)
+        : std::runtime_error(msg + " (linha " + std::to_string(linha) +
+                             ", coluna " + std::to_string(coluna) + ")"),
+          _linha{linha}, _coluna{coluna} {}
+
+    size_t linha() const { return _linha; }
+    size_t coluna() const { return _coluna; }
+};
+
+// Arquivo inteiro mapeado na memoria, somente para leitura. Pipes, FIFOs e
+// outros arquivos que nao sao regulares nao tem tamanho nem podem ser
+// mapeados; esses sao lidos com read() para um buffer proprio.
+// Lanca std::system_error se o arquivo nao puder ser aberto, lido ou mapeado.
+class ArquivoMapeado {
+  char const *_dados{nullptr};
+  size_t _tamanho{0};
+  std::string _copia;
+  bool _mapeado{false};
+  struct stat _info;
+
+  // Le fd ate o fim para _copia.
+  void le_tudo(int fd, std::string const &nome) {
+    char buffer[1 << 16];
+    for (;;) {
+      ssize_t n = ::read(fd, buffer, sizeof(buffer));
+      if (n == 0) break;
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        int erro = errno;
+        ::close(fd);
+        throw std::system_error(erro, std::generic_category(), nome);
+      }
+      _copia.append(buffer, static_cast<size_t>(n));
+    }
+    _dados = _copia.data();
+    _tamanho = _copia.size();
+  }
+
+  public:
+    explicit ArquivoMapeado(std::string const &nome) {
+      int fd = ::open(nome.c_str(), O_RDONLY);
+      if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), nome);
+      }
+      struct stat &st = _info;
+      if (::fstat(fd, &st) != 0) {
+        int erro = errno;
+        ::close(fd);
+        throw std::system_error(erro, std::generic_category(), nome);
+      }
+      if (!S_ISREG(st.st_mode)) {
+        le_tudo(fd, nome);
+        ::close(fd);
+        return;
+      }
+      _tamanho = static_cast<size_t>(st.st_size);
+      // mmap nao aceita tamanho zero, um arquivo vazio fica sem mapeamento
+      if (_tamanho > 0) {
+        void *p = ::mmap(nullptr, _tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+          int erro = errno;
+          ::close(fd);
+          throw std::system_error(erro, std::generic_category(), nome);
+        }
+        ::madvise(p, _tamanho, MADV_SEQUENTIAL);
+        _dados = static_cast<char const *>(p);
+        _mapeado = true;
+      }
+      ::close(fd);
+    }
+
+    ArquivoMapeado(ArquivoMapeado const &) = delete;
+    ArquivoMapeado &operator=(ArquivoMapeado const &) = delete;
+
+    ~ArquivoMapeado() {
+      if (_mapeado) ::munmap(const_cast<char *>(_dados), _tamanho);
+    }
+
+    // Conteudo do arquivo como texto.
+    std::string_view conteudo() const { return {_dados, _tamanho}; }
+    // Resultado do fstat do arquivo aberto (dispositivo, inode, ...).
+    struct stat const &info() const { return _info; }
+};
+
+// Resultado da leitura de um numero sem excecoes (LeitorNumeros::le_na_linha).
+enum class Leitura { ok, fim_da_linha, invalido, fora_do_intervalo };
+
+// Campo de uma linha (LeitorNumeros::campos_da_linha): o texto sem os espacos
+// em volta e a coluna, a partir de 1, onde ele esta na linha.
+struct Campo {
+  std::string_view texto;
+  size_t coluna;
+};
+
+// Percorre os numeros separados por espacos em branco (incluindo quebras de
+// linha) de um texto, guardando a linha e a coluna correntes para as
+// mensagens de erro.
+class LeitorNumeros {
+  std::string_view _texto;
+  size_t _pos{0};
+  size_t _linha{1};
+  size_t _inicio_linha{0};
+  char _separador{' '};
+
+  static bool espaco(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+  // Converte o numero no inicio de texto; fim recebe onde ele termina.
+  template<typename T>
+  static Leitura converte_inicio(std::string_view texto, T &valor, size_t &fim) {
+    char const *inicio = texto.data();
+    char const *final = texto.data() + texto.size();
+    // from_chars nao aceita o sinal '+', que o operator>> aceita
+    char const *p = inicio;
+    if (p != final && *p == '+' && p + 1 != final && *(p + 1) != '-') ++p;
+    auto [ptr, ec] = std::from_chars(p, final, valor);
+    if (ec == std::errc::result_out_of_range) return Leitura::fora_do_intervalo;
+    if (ec != std::errc()) return Leitura::invalido;
+    fim = static_cast<size_t>(ptr - inicio);
+    return Leitura::ok;
+  }
+
+  // Pula os espacos em branco ate o proximo token ou o fim do texto.
+  void pula_espacos() {
+    while (_pos < _texto.size() && espaco(_texto[_pos])) {
+      if (_texto[_pos] == '\n') {
+        ++_linha;
+        _inicio_linha = _pos + 1;
+      }
+      ++_pos;
+    }
+  }
+
+  // Pula os espacos em branco sem passar do fim da linha corrente.
+  void pula_espacos_na_linha() {
+    while (_pos < _texto.size() && _texto[_pos] != '\n' && espaco(_texto[_pos])) {
+      ++_pos;
+    }
+  }
+
+  // Converte o token que comeca na posicao corrente. Se o token nao for um
+  // numero valido a posicao fica no inicio dele.
+  template<typename T>
+  Leitura tenta_converter(T &valor) {
+    auto resto = _texto.substr(_pos);
+    size_t fim = 0;
+    auto r = converte_inicio(resto, valor, fim);
+    if (r != Leitura::ok) return r;
+    if (fim != resto.size() && !espaco(resto[fim])) return Leitura::invalido;
+    _pos += fim;
+    return Leitura::ok;
+  }
+
+  // Como tenta_converter, mas lanca ErroLeitura.
+  template<typename T>
+  void converte(T &valor) {
+    auto r = tenta_converter(valor);
+    if (r == Leitura::fora_do_intervalo) {
+      throw ErroLeitura("Valor fora do intervalo", linha(), coluna());
+    }
+    if (r == Leitura::invalido) throw ErroLeitura("Valor invalido", linha(), coluna());
+  }
+
+  public:
+    // linha_inicial e a linha do arquivo onde texto comeca, para quando o
+    // texto e so uma parte do arquivo.
+    explicit LeitorNumeros(std::string_view texto, size_t linha_inicial = 1)
+        : _texto{texto}, _linha{linha_inicial} {}
+
+    // Separa os campos de campos_da_linha por separador (por exemplo ',' em
+    // arquivos CSV) em vez de por espacos em branco.
+    void separa_por(char separador) { _separador = separador; }
+
+    // Le os campos da linha corrente, deixando a posicao no fim dela. Com
+    // separador (separa_por) cada separador comeca um campo novo, entao os
+    // campos podem ser vazios ("4,,6" tem tres campos); sem, os campos sao
+    // os trechos entre espacos em branco. Uma linha em branco nao tem campos.
+    void campos_da_linha(std::vector<Campo> &campos) {
+      campos.clear();
+      size_t fim = _texto.find('\n', _pos);
+      if (fim == std::string_view::npos) fim = _texto.size();
+      auto campo = [&](size_t inicio, size_t final) {
+        while (inicio < final && espaco(_texto[inicio])) ++inicio;
+        while (final > inicio && espaco(_texto[final - 1])) --final;
+        campos.push_back({_texto.substr(inicio, final - inicio), inicio - _inicio_linha + 1});
+      };
+      if (_separador == ' ') {
+        for (size_t i = _pos; i < fim;) {
+          while (i < fim && espaco(_texto[i])) ++i;
+          size_t inicio = i;
+          while (i < fim && !espaco(_texto[i])) ++i;
+          if (i > inicio) campo(inicio, i);
+        }
+      } else {
+        size_t inicio = _pos;
+        while (inicio < fim && espaco(_texto[inicio])) ++inicio;
+        if (inicio < fim) {
+          inicio = _pos;
+          for (size_t i = _pos; i <= fim; ++i) {
+            if (i == fim || _texto[i] == _separador) {
+              campo(inicio, i);
+              inicio = i + 1;
+            }
+          }
+        }
+      }
+      _pos = fim;
+    }
+
+    // Converte um campo inteiro em valor, sem excecoes. Um campo vazio ou
+    // com mais que um numero e Leitura::invalido.
+    template<typename T>
+    static Leitura converte_campo(Campo const &campo, T &valor) {
+      size_t fim = 0;
+      auto r = converte_inicio(campo.texto, valor, fim);
+      if (r == Leitura::ok && fim != campo.texto.size()) return Leitura::invalido;
+      return r;
+    }
+
+    // Le o proximo numero em valor. Retorna false se o texto acabou e lanca
+    // ErroLeitura se o proximo token nao for um numero valido.
+    template<typename T>
+    bool proximo(T &valor) {
+      pula_espacos();
+      if (_pos == _texto.size()) return false;
+      converte(valor);
+      return true;
+    }
+
+    // Como proximo, mas retorna false no fim da linha corrente em vez de
+    // passar para a proxima.
+    template<typename T>
+    bool proximo_na_linha(T &valor) {
+      pula_espacos_na_linha();
+      if (_pos == _texto.size() || _texto[_pos] == '\n') return false;
+      converte(valor);
+      return true;
+    }
+
+    // Como proximo_na_linha, mas sem excecoes: um token invalido e retornado
+    // como Leitura::invalido ou Leitura::fora_do_intervalo, com a posicao
+    // corrente no inicio dele.
+    template<typename T>
+    Leitura le_na_linha(T &valor) {
+      pula_espacos_na_linha();
+      if (_pos == _texto.size() || _texto[_pos] == '\n') return Leitura::fim_da_linha;
+      return tenta_converter(valor);
+    }
+
+    // Verifica se so restam espacos em branco na linha corrente.
+    bool no_fim_da_linha() {
+      pula_espacos_na_linha();
+      return _pos == _texto.size() || _texto[_pos] == '\n';
+    }
+
+    // Passa para o inicio da proxima linha, ignorando o resto da corrente.
+    // Retorna false se o texto acabou.
+    bool proxima_linha() {
+      auto fim = _texto.find('\n', _pos);
+      if (fim == std::string_view::npos) {
+        _pos = _texto.size();
+        return false;
+      }
+      _pos = fim + 1;
+      ++_linha;
+      _inicio_linha = _pos;
+      return _pos < _texto.size();
+    }
+
+    // Posicao corrente, a partir de 1.
+    size_t linha() const { return _linha; }
+    size_t coluna() const { return _pos - _inicio_linha + 1; }
+};
+
+// Divide o texto em ate n partes de tamanhos parecidos, cada uma terminando
+// logo depois de uma quebra de linha (ou no fim do texto), para que nenhum
+// numero fique dividido entre duas partes.
+inline std::vector<std::string_view> divide_em_linhas(std::string_view texto,
+                                                      size_t n) {
+  std::vector<std::string_view> partes;
+  size_t inicio = 0;
+  for (size_t i = 1; i <= n && inicio < texto.size(); ++i) {
+    size_t fim = i == n ? texto.size() : texto.size() / n * i;
+    if (fim < inicio) fim = inicio;
+    fim = texto.find('\n', fim);
+    fim = fim == std::string_view::npos ? texto.size() : fim + 1;
+    partes.push_back(texto.substr(inicio, fim - inicio));
+    inicio = fim;
+  }
+  return partes;
+}
+
+#endif
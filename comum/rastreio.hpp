@@ -0,0 +1,247 @@
+/*Instrumentacao dos programas: tempos de trechos e contadores.
+
+RASTREIO_ESCOPO("nome") mede o tempo do escopo onde aparece e
+RASTREIO_CONTA("nome", n) soma n a um contador. Os nomes tem que ser
+literais (ou outras strings que durem ate o fim do programa). Cada thread
+guarda os seus eventos em um buffer proprio, juntado ao registro global
+quando ela termina, entao as threads nao disputam nada enquanto medem.
+
+O rastreio comeca desligado e e ligado em tempo de execucao com
+rastreio::liga(); desligado, cada escopo custa so a leitura de uma flag
+atomica. Compilando com -DRASTREIO_DESLIGADO as macros nao geram codigo
+nenhum.
+
+Os resultados saem em dois formatos:
+
+  rastreio::escreve_trace(os)   JSON do Chrome trace (chrome://tracing ou
+                                ui.perfetto.dev): um evento "X" por escopo,
+                                com a thread, e os contadores no fim
+  rastreio::escreve_resumo(os)  tabela com chamadas, tempo total, medio e
+                                maximo de cada nome e os contadores
+
+Os dois so incluem os eventos das threads que ja terminaram e os da thread
+que chama a funcao. Nos programas, rastreio::Sessao trata as opcoes
+--trace F (escreve o trace em F) e --metrics (escreve o resumo na saida de
+erro).
+*/
+
+#ifndef COMUM_RASTREIO_HPP
+#define COMUM_RASTREIO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rastreio {
+
+// Um escopo medido, com os tempos em nanossegundos desde o inicio do
+// programa.
+struct Evento {
+  char const *nome;
+  std::uint64_t inicio_ns;
+  std::uint64_t duracao_ns;
+  std::uint32_t thread;
+};
+
+// Eventos e contadores juntados das threads.
+class Registro {
+  std::mutex _mutex;
+  std::vector<Evento> _eventos;
+  std::map<std::string, std::uint64_t> _contadores;
+
+  public:
+    std::atomic<bool> ativo{false};
+    std::atomic<std::uint32_t> proxima_thread{0};
+    std::chrono::steady_clock::time_point const inicio = std::chrono::steady_clock::now();
+
+    void junta(std::vector<Evento> &eventos,
+               std::vector<std::pair<char const *, std::uint64_t>> &contadores) {
+      std::lock_guard<std::mutex> trava(_mutex);
+      _eventos.insert(_eventos.end(), eventos.begin(), eventos.end());
+      for (auto const &[nome, valor]: contadores) _contadores[nome] += valor;
+      eventos.clear();
+      contadores.clear();
+    }
+
+    // Copia dos eventos (em ordem de inicio) e dos contadores juntados.
+    std::vector<Evento> eventos() {
+      std::lock_guard<std::mutex> trava(_mutex);
+      auto e = _eventos;
+      std::sort(e.begin(), e.end(),
+                [](Evento const &a, Evento const &b) { return a.inicio_ns < b.inicio_ns; });
+      return e;
+    }
+    std::map<std::string, std::uint64_t> contadores() {
+      std::lock_guard<std::mutex> trava(_mutex);
+      return _contadores;
+    }
+};
+
+inline Registro &registro() {
+  static Registro r;
+  return r;
+}
+
+// Buffer de uma thread, juntado ao registro quando a thread termina.
+struct BufferDaThread {
+  std::uint32_t thread = registro().proxima_thread++;
+  std::vector<Evento> eventos;
+  std::vector<std::pair<char const *, std::uint64_t>> contadores;
+
+  ~BufferDaThread() { registro().junta(eventos, contadores); }
+};
+
+inline BufferDaThread &buffer() {
+  thread_local BufferDaThread b;
+  return b;
+}
+
+inline void liga() { registro().ativo.store(true, std::memory_order_relaxed); }
+inline bool ativo() { return registro().ativo.load(std::memory_order_relaxed); }
+
+inline std::uint64_t agora_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - registro().inicio).count();
+}
+
+// Soma n ao contador nome (se o rastreio estiver ligado).
+inline void conta(char const *nome, std::uint64_t n) {
+  if (!ativo()) return;
+  auto &contadores = buffer().contadores;
+  for (auto &c: contadores) {
+    if (c.first == nome || std::strcmp(c.first, nome) == 0) {
+      c.second += n;
+      return;
+    }
+  }
+  contadores.emplace_back(nome, n);
+}
+
+// Mede o tempo entre a construcao e a destruicao.
+class Escopo {
+  char const *_nome;
+  std::uint64_t _inicio{0};
+
+  public:
+    explicit Escopo(char const *nome) : _nome{ativo() ? nome : nullptr} {
+      if (_nome) _inicio = agora_ns();
+    }
+    Escopo(Escopo const &) = delete;
+    Escopo &operator=(Escopo const &) = delete;
+    ~Escopo() {
+      if (!_nome) return;
+      auto &b = buffer();
+      b.eventos.push_back({_nome, _inicio, agora_ns() - _inicio, b.thread});
+    }
+};
+
+// Junta os eventos da thread corrente ao registro, para que entrem na saida.
+inline void junta_thread_corrente() {
+  auto &b = buffer();
+  registro().junta(b.eventos, b.contadores);
+}
+
+inline void escreve_trace(std::ostream &os) {
+  junta_thread_corrente();
+  auto eventos = registro().eventos();
+  os << "{\"traceEvents\":[";
+  bool primeiro = true;
+  std::uint64_t fim = 0;
+  for (auto const &e: eventos) {
+    os << (primeiro ? "\n" : ",\n") << std::fixed << std::setprecision(3)
+       << "{\"name\":\"" << e.nome << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+       << ",\"ts\":" << e.inicio_ns/1e3 << ",\"dur\":" << e.duracao_ns/1e3 << "}";
+    fim = std::max(fim, e.inicio_ns + e.duracao_ns);
+    primeiro = false;
+  }
+  for (auto const &[nome, valor]: registro().contadores()) {
+    os << (primeiro ? "\n" : ",\n") << "{\"name\":\"" << nome
+       << "\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << fim/1e3
+       << ",\"args\":{\"valor\":" << valor << "}}";
+    primeiro = false;
+  }
+  os << "\n]}\n";
+}
+
+inline void escreve_resumo(std::ostream &os) {
+  junta_thread_corrente();
+  struct Total {
+    std::uint64_t chamadas{0}, total_ns{0}, max_ns{0};
+  };
+  std::map<std::string, Total> totais;
+  for (auto const &e: registro().eventos()) {
+    auto &t = totais[e.nome];
+    ++t.chamadas;
+    t.total_ns += e.duracao_ns;
+    t.max_ns = std::max(t.max_ns, e.duracao_ns);
+  }
+  os << "escopo\tchamadas\ttotal_ms\tmedia_us\tmax_us\n" << std::fixed << std::setprecision(3);
+  for (auto const &[nome, t]: totais) {
+    os << nome << "\t" << t.chamadas << "\t" << t.total_ns/1e6 << "\t"
+       << t.total_ns/1e3/t.chamadas << "\t" << t.max_ns/1e3 << "\n";
+  }
+  auto contadores = registro().contadores();
+  if (!contadores.empty()) {
+    os << "contador\tvalor\n";
+    for (auto const &[nome, valor]: contadores) os << nome << "\t" << valor << "\n";
+  }
+}
+
+// Opcoes --trace F e --metrics de um programa. As opcoes sao retiradas de
+// args e, se alguma foi dada, o rastreio e ligado; no fim da sessao o trace
+// e escrito em F e o resumo na saida de erro.
+class Sessao {
+  std::string _trace;
+  bool _resumo{false};
+
+  public:
+    explicit Sessao(std::vector<char const *> &args) {
+      std::vector<char const *> resto;
+      for (size_t i = 0; i < args.size(); ++i) {
+        std::string arg = args[i];
+        if (arg == "--trace" && i + 1 < args.size()) _trace = args[++i];
+        else if (arg == "--metrics") _resumo = true;
+        else resto.push_back(args[i]);
+      }
+      args = resto;
+      if (!_trace.empty() || _resumo) liga();
+    }
+    Sessao(Sessao const &) = delete;
+    Sessao &operator=(Sessao const &) = delete;
+
+    ~Sessao() {
+      if (!_trace.empty()) {
+        std::ofstream os(_trace);
+        escreve_trace(os);
+        if (!os) std::cerr << "Erro escrevendo " << _trace << std::endl;
+      }
+      if (_resumo) escreve_resumo(std::cerr);
+    }
+};
+
+}
+
+#define RASTREIO_CONCATENA_(a, b) a##b
+#define RASTREIO_CONCATENA(a, b) RASTREIO_CONCATENA_(a, b)
+
+#ifdef RASTREIO_DESLIGADO
+#define RASTREIO_ESCOPO(nome) ((void)0)
+// sizeof nao avalia n, mas conta como uso das variaveis que aparecem nele
+#define RASTREIO_CONTA(nome, n) ((void)sizeof(n))
+#else
+#define RASTREIO_ESCOPO(nome) rastreio::Escopo RASTREIO_CONCATENA(rastreio_escopo_, __LINE__)(nome)
+#define RASTREIO_CONTA(nome, n) rastreio::conta(nome, n)
+#endif
+
+#endif
@@ -1,104 +1,277 @@
-/*Programa que dado um arquivo de entrada com um conjunto de valores,
-calcula a média, o desvio padrão e um histograma desses valores.
-*/
-
-#include <iostream>
-#include <fstream>
-#include <math.h>
-#include <vector>
-#include <array>
-#include <tuple>
-
-//template das funcoes
-std::vector<double> read_file(char const *filename);
-std::array<double, 2> estat_data(std::vector<double> const &data);
-std::tuple<std::vector<int>, std::vector<double>> box_histogram(std::vector<double> const &data, int B);
-
-int main(int, char const *args[]) {
-  std::vector<double> vector_data;
-
-  //Recebe os parametros
-  int B = std::stoi(args[2]);
-  vector_data = read_file(args[1]); //chama a funcao de ler as linhas
-  
-  //chama as funcoes do histograma e calculo media e desvio padrao
-  auto [mean, stdev] = estat_data(vector_data);
-  auto [count_box, informacao_box] = box_histogram(vector_data, B);
-
-  //Print dos resultados
-  std::cout << vector_data.size() << std::endl; //numero de elementos
-  std::cout << mean << std::endl; //media
-  std::cout << stdev << std::endl; //desvio padrao
-
-  //Print do resultado do histograma separado por " "
-  for(int i = 0; i < B; ++i){
-      std::cout << informacao_box[i] << " " << informacao_box[i + 1] << " " << count_box[i] << std::endl;
-  }
-
-  return 0;
-}
-
-
-std::vector<double> read_file(char const *filename) {
-  std::vector<double> data;
-  std::ifstream file(filename);
-  double val;
-
-  //Ler Linhas e as guarda no vetor
-  while (file >> val) {
-    data.push_back(val);
-  }
-
-  return data;
-}
-
-std::array<double,2> estat_data(std::vector<double> const &data) {
-  double mean{0}, stdev{0};
-
-  //Media
-  for (auto x: data) {
-    mean += x;
-  }
-  mean /= data.size();
-
-  //Desvio padrão
-  for (auto x: data) {
-    stdev += pow(x - mean, 2);
-  }
-  stdev /= (data.size() - 1);
-  stdev = pow(stdev, 0.5);
-
-  return {mean, stdev};
-}
-
-std::tuple<std::vector<int>, std::vector<double>> box_histogram(std::vector<double> const &data, int B){
-  std::vector<int> count(B);
-  std::vector<double> info(B + 1);
-  double box_size;
-  double max{data[0]}, min{data[0]};
-  int k;
-
-  //Acha o max e min
-  for (auto x: data){
-    if(max < x) max = x;
-    if(min > x) min = x;
-  }
-
-  box_size = (max - min)/B;
-  
-  //Computa a que caixa ele pertence
-  for (auto x: data) {
-    if (x != max) {
-      k = floor((x - min)/box_size);
-      ++count[k];
-    }
-    else ++count[B - 1];
-  }
-
-  //gera o vetor informacao das caixas
-  for (int i = 0; i <= B; ++i) {
-    info[i] = min + box_size*i;
-  }
-
-  return {count, info};
-}
\ No newline at end of file
+/*Programa que dado um arquivo de entrada com um conjunto de valores,
+calcula a média, o desvio padrão e um histograma desses valores.
+
+Os calculos estao em estat.hpp; aqui fica so a linha de comando.
+
+Compilar: g++ -std=c++17 -O2 -pthread estat.cpp -o estat
+*/
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <system_error>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include "estat.hpp"
+
+//Opcoes da linha de comando
+struct Opcoes {
+  char const *filename;
+  int B;
+  bool stream{false};
+  int threads{0};
+  bool count64{false};
+  bool sketch{false};
+  char const *sketch_out{nullptr};
+  std::vector<char const *> sketch_in;
+  std::string cache;
+};
+
+//Funcoes da linha de comando
+template<typename Count> int estat_main(Opcoes const &op);
+int batch_main(int argc, char const *args[]);
+
+//Uso: estat <arquivo> <numero de caixas> [--stream] [--threads N] [--count64] [--trace F] [--metrics]
+//
+//Com --stream os valores nao sao guardados na memoria: uma passada pelo
+//arquivo calcula numero de elementos, media, desvio padrao, minimo e maximo
+//e uma segunda passada monta o histograma. A saida e a mesma do modo normal.
+//
+//Com --threads N as duas passadas do modo --stream sao feitas em paralelo:
+//o arquivo e dividido em N partes em quebras de linha e cada thread le a sua
+//parte. Na primeira passada os resultados parciais sao combinados aos pares;
+//na segunda cada thread conta em caixas proprias, somadas no final. A media
+//e o desvio padrao diferem dos de estat_data so pelo arredondamento, com erro
+//relativo da ordem de log2(N)*2.2e-16, bem abaixo dos 6 digitos impressos;
+//contagem, minimo, maximo e histograma sao exatamente iguais.
+//
+//O arquivo pode estar em texto ou no formato binario colunar (gerado por
+//comum/converte.cpp), detectado automaticamente. Arquivos binarios com o
+//esquema do queda sao recusados (codigo de saida 3).
+//
+//Com --count64 as caixas do histograma contam com inteiros de 64 bits, para
+//entradas com mais de 2^31 valores.
+//
+//Com --sketch o arquivo e lido uma unica vez e, alem das estatisticas exatas,
+//os valores vao para um sketch de memoria limitada (sketch.hpp). O histograma
+//sai do sketch, portanto aproximado, e sao impressos tambem a mediana e os
+//percentis 95 e 99, com erro relativo de ate 0,1%. --sketch-out F salva as
+//estatisticas e o sketch em F e cada --sketch-in F junta um sketch salvo ao
+//resultado, para combinar varios arquivos sem concatena-los.
+//
+//Com --cache (ou --cache-file F) o modo --sketch guarda o estado lido em
+//<arquivo>.estat-cache (ou F): estatisticas, sketch, dispositivo e inode do
+//arquivo, ate que byte ele foi lido e hashes dos primeiros e dos ultimos
+//4 KiB desse trecho. Na proxima execucao so os bytes acrescentados depois sao
+//lidos. Se o inode mudou, o arquivo diminuiu ou os hashes nao batem, o
+//arquivo foi reescrito e e lido inteiro de novo. Uma reescrita no mesmo
+//inode que so muda bytes no meio do trecho ja lido nao e detectada; nesse
+//caso apague o cache.
+//
+//Modo em lote:
+//  estat --batch <numero de caixas> [--colunas 1,3] [--csv] [--threads N] <arquivos...>
+//Cada arquivo e lido uma vez e estat_data e box_histogram sao calculados
+//para cada coluna (todas ou as escolhidas em --colunas, a partir de 1). As
+//colunas sao separadas por espacos ou, com --csv, por virgulas, e todas as
+//linhas precisam ter o mesmo numero de colunas; com --csv um campo vazio e
+//um erro. Uma primeira linha que nao e so de numeros e um cabecalho e e
+//ignorada. Os arquivos sao processados em paralelo por N threads (padrao: uma por
+//nucleo) e o resultado sai em uma tabela separada por tabulacoes, uma
+//linha por arquivo e coluna, com as contagens das caixas separadas por
+//virgulas.
+//
+//Em todos os modos, --trace F grava em F um trace no formato do Chrome
+//(chrome://tracing ou ui.perfetto.dev) com o tempo de cada etapa e
+//--metrics escreve na saida de erro um resumo com os tempos e o numero de
+//valores lidos (comum/rastreio.hpp).
+int main(int argc, char const *argv[]) {
+  std::vector<char const *> argumentos(argv, argv + argc);
+  rastreio::Sessao sessao(argumentos);
+  argc = argumentos.size();
+  char const **args = argumentos.data();
+
+  if (argc > 1 && std::string(args[1]) == "--batch") return batch_main(argc, args);
+
+  //Recebe os parametros
+  Opcoes op;
+  op.filename = args[1];
+  op.B = std::stoi(args[2]);
+  for (int i = 3; i < argc; ++i) {
+    std::string arg = args[i];
+    if (arg == "--stream") op.stream = true;
+    else if (arg == "--threads" && i + 1 < argc) op.threads = std::stoi(args[++i]);
+    else if (arg == "--count64") op.count64 = true;
+    else if (arg == "--sketch") op.sketch = true;
+    else if (arg == "--sketch-out" && i + 1 < argc) op.sketch_out = args[++i];
+    else if (arg == "--sketch-in" && i + 1 < argc) op.sketch_in.push_back(args[++i]);
+    else if (arg == "--cache") op.cache = std::string(op.filename) + ".estat-cache";
+    else if (arg == "--cache-file" && i + 1 < argc) op.cache = args[++i];
+  }
+
+  if (op.count64) return estat_main<std::int64_t>(op);
+  return estat_main<int>(op);
+}
+
+//Calcula e imprime os resultados contando as caixas com o tipo Count
+template<typename Count>
+int estat_main(Opcoes const &op) {
+  int B = op.B;
+  size_t n;
+  double mean, stdev;
+  std::vector<Count> count_box;
+  std::vector<double> informacao_box;
+  std::vector<double> percentis;
+
+  try {
+    if (op.sketch || !op.cache.empty()) {
+      //uma passada so, com histograma e percentis aproximados
+      Acumulador acc;
+      Sketch sketch;
+      if (op.cache.empty()) estat_sketch(op.filename, op.threads, acc, sketch);
+      else estat_incremental(op.filename, op.cache, op.threads, acc, sketch);
+      for (auto f: op.sketch_in) carrega_sketch(f, acc, sketch);
+      if (op.sketch_out) salva_sketch(op.sketch_out, acc, sketch);
+      n = acc.n;
+      mean = acc.mean;
+      stdev = acc.stdev();
+      count_box = sketch.histograma<Count>(B);
+      informacao_box.resize(B + 1);
+      for (int i = 0; i <= B; ++i) {
+        informacao_box[i] = acc.min + (acc.max - acc.min)/B*i;
+      }
+      percentis = {sketch.quantil(0.5), sketch.quantil(0.95), sketch.quantil(0.99)};
+    } else if (op.stream || op.threads > 0) {
+      //duas passadas pelo arquivo com memoria constante
+      if (op.threads > 0) {
+        auto acc = estat_parallel(op.filename, op.threads);
+        n = acc.n;
+        mean = acc.mean;
+        stdev = acc.stdev();
+        std::tie(count_box, informacao_box) = box_histogram_parallel<Count>(op.filename, acc, B, op.threads);
+      } else {
+        auto acc = estat_stream(op.filename);
+        n = acc.n;
+        mean = acc.mean;
+        stdev = acc.stdev();
+        std::tie(count_box, informacao_box) = box_histogram_stream<Count>(op.filename, acc, B);
+      }
+    } else {
+      //le os valores (sem copia no formato colunar float64)
+      ValoresArquivo dados(op.filename);
+      Valores data = dados.valores();
+
+      //chama as funcoes do histograma e calculo media e desvio padrao
+      n = data.n;
+      auto estat = estat_data(data);
+      mean = estat[0];
+      stdev = estat[1];
+      std::tie(count_box, informacao_box) = box_histogram<Count>(data, B);
+    }
+  } catch (std::system_error const &e) {
+    std::cerr << "Erro abrindo " << e.what() << std::endl;
+    return 2;
+  } catch (ErroLeitura const &e) {
+    std::cerr << "Erro lendo " << op.filename << ": " << e.what() << std::endl;
+    return 3;
+  } catch (ErroFormato const &e) {
+    std::cerr << "Erro lendo " << op.filename << ": " << e.what() << std::endl;
+    return 3;
+  } catch (std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  //Print dos resultados
+  RASTREIO_ESCOPO("saida");
+  std::cout << n << std::endl; //numero de elementos
+  std::cout << mean << std::endl; //media
+  std::cout << stdev << std::endl; //desvio padrao
+
+  //Print do resultado do histograma separado por " "
+  for(int i = 0; i < B; ++i){
+      std::cout << informacao_box[i] << " " << informacao_box[i + 1] << " " << count_box[i] << std::endl;
+  }
+
+  //Percentis do modo --sketch
+  if (!percentis.empty()) {
+    std::cout << "p50 " << percentis[0] << std::endl;
+    std::cout << "p95 " << percentis[1] << std::endl;
+    std::cout << "p99 " << percentis[2] << std::endl;
+  }
+
+  return 0;
+}
+
+//Modo --batch: processa varios arquivos em paralelo e imprime uma tabela
+int batch_main(int argc, char const *args[]) {
+  int B = std::stoi(args[2]);
+  std::vector<size_t> colunas;
+  char separador = ' ';
+  int threads = std::thread::hardware_concurrency();
+  std::vector<char const *> arquivos;
+  for (int i = 3; i < argc; ++i) {
+    std::string arg = args[i];
+    if (arg == "--colunas" && i + 1 < argc) {
+      std::string lista = args[++i];
+      for (size_t p = 0; p < lista.size();) {
+        size_t virgula = lista.find(',', p);
+        if (virgula == std::string::npos) virgula = lista.size();
+        colunas.push_back(std::stoul(lista.substr(p, virgula - p)));
+        p = virgula + 1;
+      }
+    }
+    else if (arg == "--csv") separador = ',';
+    else if (arg == "--threads" && i + 1 < argc) threads = std::stoi(args[++i]);
+    else arquivos.push_back(args[i]);
+  }
+  if (threads < 1) threads = 1;
+
+  //cada thread pega o proximo arquivo ainda nao processado
+  std::vector<std::vector<ResultadoColuna>> resultados(arquivos.size());
+  std::vector<std::string> erros(arquivos.size());
+  std::vector<int> codigos(arquivos.size(), 0);
+  std::atomic<size_t> proximo{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      for (size_t i = proximo++; i < arquivos.size(); i = proximo++) {
+        try {
+          resultados[i] = estat_colunas(arquivos[i], colunas, separador, B);
+        } catch (std::system_error const &e) {
+          erros[i] = std::string("Erro abrindo ") + e.what();
+          codigos[i] = 2;
+        } catch (std::exception const &e) {
+          erros[i] = std::string("Erro lendo ") + arquivos[i] + ": " + e.what();
+          codigos[i] = 3;
+        }
+      }
+    });
+  }
+  for (auto &w: workers) w.join();
+
+  RASTREIO_ESCOPO("saida");
+  int codigo = 0;
+  std::cout << std::setprecision(15);
+  std::cout << "arquivo\tcoluna\tn\tmedia\tdesvio\tmin\tmax\tcontagens\n";
+  for (size_t i = 0; i < arquivos.size(); ++i) {
+    if (codigos[i]) {
+      std::cerr << erros[i] << std::endl;
+      codigo = std::max(codigo, codigos[i]);
+    }
+    for (auto const &r: resultados[i]) {
+      std::cout << arquivos[i] << "\t" << r.coluna << "\t" << r.n << "\t" << r.mean << "\t"
+                << r.stdev << "\t" << r.min << "\t" << r.max << "\t";
+      for (int k = 0; k < B; ++k) {
+        std::cout << (k ? "," : "") << r.count[k];
+      }
+      std::cout << "\n";
+    }
+  }
+
+  return codigo;
+}
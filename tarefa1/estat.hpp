@@ -0,0 +1,743 @@
+/*Biblioteca do estat: leitura dos valores, estatisticas e histogramas em
+todos os modos (na memoria, em duas passadas, em paralelo, com sketch e com
+cache), sem nada da linha de comando de estat.cpp.
+
+Os calculos sobre valores ja na memoria recebem uma visao dos valores
+(Valores) e retornam estruturas: estat_data, box_histogram e estatisticas,
+que junta os dois. box_histogram e estatisticas precisam de ao menos um
+valor e de B > 0 caixas e lancam std::invalid_argument se nao. Os outros
+modos leem um arquivo e lancam
+std::system_error se ele nao puder ser aberto e ErroLeitura ou ErroFormato
+se os dados forem invalidos.
+
+As funcoes principais sao medidas com comum/rastreio.hpp (escopos com o
+nome da funcao e o contador "valores" dos valores lidos), o que so custa
+algo com o rastreio ligado.
+*/
+
+#ifndef TAREFA1_ESTAT_HPP
+#define TAREFA1_ESTAT_HPP
+
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "../comum/leitura.hpp"
+#include "../comum/colunar.hpp"
+#include "../comum/rastreio.hpp"
+#include "kernels.hpp"
+#include "sketch.hpp"
+
+//Acumulador das estatisticas em uma unica passada (algoritmo de Welford).
+//Guarda so o numero de elementos, a media, a soma dos quadrados dos desvios
+//(M2), o minimo e o maximo, entao a memoria nao depende do tamanho da entrada.
+struct Acumulador {
+  size_t n{0};
+  double mean{0}, m2{0};
+  double min{0}, max{0};
+
+  //Adiciona um valor atualizando media, M2, minimo e maximo
+  void add(double x) {
+    ++n;
+    if (n == 1) {
+      min = max = x;
+    } else {
+      if (max < x) max = x;
+      if (min > x) min = x;
+    }
+    double delta = x - mean;
+    mean += delta/n;
+    m2 += delta*(x - mean);
+  }
+
+  //Junta as estatisticas de outra parte (disjunta) dos dados, com a formula
+  //de combinacao de Chan et al. para media e M2
+  void merge(Acumulador const &o) {
+    if (o.n == 0) return;
+    if (n == 0) {
+      *this = o;
+      return;
+    }
+    double total = double(n) + double(o.n);
+    double delta = o.mean - mean;
+    mean += delta*(o.n/total);
+    m2 += o.m2 + delta*delta*(n*(o.n/total));
+    n += o.n;
+    if (max < o.max) max = o.max;
+    if (min > o.min) min = o.min;
+  }
+
+  //Desvio padrao amostral
+  double stdev() const { return sqrt(m2/(n - 1)); }
+};
+
+//Visao somente leitura de valores contiguos na memoria (como o std::span do
+//C++20), para as funcoes que calculam sobre dados ja lidos
+struct Valores {
+  double const *dados;
+  size_t n;
+
+  Valores(double const *d, size_t tamanho) : dados{d}, n{tamanho} {}
+  Valores(std::vector<double> const &v) : dados{v.data()}, n{v.size()} {}
+};
+
+//Resultado de estatisticas(): numero de valores, media, desvio padrao,
+//minimo, maximo e o histograma com B caixas
+template<typename Count = int>
+struct Estatisticas {
+  size_t n{0};
+  double mean{0}, stdev{0}, min{0}, max{0};
+  std::vector<Count> count;    //contagem de cada caixa
+  std::vector<double> limites; //B + 1 limites das caixas
+};
+
+//Estatisticas e histograma de uma coluna de um arquivo no modo --batch
+struct ResultadoColuna : Estatisticas<std::int64_t> {
+  size_t coluna;
+};
+
+//Funcoes da biblioteca
+inline ArquivoColunar abre_colunar(std::string_view conteudo);
+template<typename F> void for_each_value(char const *filename, F f);
+inline std::vector<double> read_file(char const *filename);
+inline std::array<double, 2> estat_data(Valores data);
+template<typename Count = int>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram(Valores data, int B);
+template<typename Count = int>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram(Valores data, int B, double min, double max);
+inline void verifica_histograma(Valores data, int B);
+template<typename Count = int>
+inline Estatisticas<Count> estatisticas(Valores data, int B);
+inline int box_index(double x, double min, double max, double box_size, int B);
+inline Acumulador estat_stream(char const *filename);
+template<typename Count = int>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram_stream(char const *filename, Acumulador const &acc, int B);
+template<typename F> void for_each_chunk_parallel(std::string_view conteudo, int threads, F f, char const *inicio_arquivo = nullptr);
+inline Acumulador merge_pairwise(std::vector<Acumulador> const &parciais, size_t inicio, size_t fim);
+inline Acumulador estat_parallel(char const *filename, int threads);
+template<typename Count = int>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram_parallel(char const *filename, Acumulador const &acc, int B, int threads);
+inline void estat_sketch(char const *filename, int threads, Acumulador &acc, Sketch &sketch);
+inline void estat_sketch_conteudo(std::string_view conteudo, int threads, Acumulador &acc, Sketch &sketch, char const *inicio_arquivo = nullptr);
+inline void salva_estado(std::ostream &os, Acumulador const &acc, Sketch const &sketch);
+inline void carrega_estado(std::istream &is, Acumulador &acc, Sketch &sketch);
+inline void salva_sketch(char const *filename, Acumulador const &acc, Sketch const &sketch);
+inline void carrega_sketch(char const *filename, Acumulador &acc, Sketch &sketch);
+inline std::uint64_t hash_bytes(std::string_view bytes);
+inline void estat_incremental(char const *filename, std::string const &cache, int threads, Acumulador &acc, Sketch &sketch);
+inline std::vector<ResultadoColuna> estat_colunas(char const *filename, std::vector<size_t> colunas, char separador, int B);
+
+//Abre um arquivo colunar de valores do estat. Outros esquemas (como o das
+//trajetorias do queda) lancam ErroFormato em vez de ter a primeira coluna
+//lida como valores.
+inline ArquivoColunar abre_colunar(std::string_view conteudo) {
+  ArquivoColunar colunar(conteudo);
+  if (colunar.esquema() != Esquema::estat) throw ErroFormato("Arquivo colunar nao e de valores do estat");
+  return colunar;
+}
+
+//Le os valores do arquivo um a um, chamando f para cada valor lido.
+//O arquivo e mapeado na memoria e convertido sem copias (comum/leitura.hpp);
+//no formato binario (comum/colunar.hpp) os valores da primeira coluna sao
+//lidos direto, sem conversao de texto.
+template<typename F>
+void for_each_value(char const *filename, F f) {
+  ArquivoMapeado file(filename);
+  double val;
+
+  if (e_colunar(file.conteudo())) {
+    auto colunar = abre_colunar(file.conteudo());
+    LeitorColuna leitor(colunar, 0, 0, colunar.linhas());
+    while (leitor.proximo(val)) {
+      f(val);
+    }
+    return;
+  }
+
+  LeitorNumeros leitor(file.conteudo());
+  while (leitor.proximo(val)) {
+    f(val);
+  }
+}
+
+inline std::vector<double> read_file(char const *filename) {
+  RASTREIO_ESCOPO("read_file");
+  std::vector<double> data;
+
+  //Ler Linhas e as guarda no vetor
+  for_each_value(filename, [&](double val) { data.push_back(val); });
+  RASTREIO_CONTA("valores", data.size());
+
+  return data;
+}
+
+//Valores de um arquivo para os calculos na memoria. Com a primeira coluna de
+//um arquivo colunar em float64 os valores sao lidos direto do arquivo
+//mapeado, sem copia; nos outros casos sao convertidos para um vetor.
+class ValoresArquivo {
+  std::unique_ptr<ArquivoMapeado> _arquivo;
+  std::vector<double> _copia;
+  Valores _valores{nullptr, 0};
+
+  public:
+    explicit ValoresArquivo(char const *filename) {
+      RASTREIO_ESCOPO("read_file");
+      _arquivo = std::make_unique<ArquivoMapeado>(filename);
+      if (e_colunar(_arquivo->conteudo())) {
+        auto colunar = abre_colunar(_arquivo->conteudo());
+        if (auto dados = colunar.coluna_double(0)) {
+          _valores = Valores(dados, colunar.linhas());
+          RASTREIO_CONTA("valores", _valores.n);
+          return;
+        }
+      }
+      _arquivo.reset();
+      _copia = read_file(filename);
+      _valores = Valores(_copia);
+    }
+
+    ValoresArquivo(ValoresArquivo const &) = delete;
+    ValoresArquivo &operator=(ValoresArquivo const &) = delete;
+
+    Valores valores() const { return _valores; }
+};
+
+//As somas usam os kernels vetorizados de kernels.hpp
+inline std::array<double,2> estat_data(Valores data) {
+  RASTREIO_ESCOPO("estat_data");
+  double mean{0}, stdev{0};
+  auto const &k = kernels();
+
+  //Media
+  mean = k.soma(data.dados, data.n);
+  mean /= data.n;
+
+  //Desvio padrão
+  stdev = k.soma_desvios(data.dados, data.n, mean);
+  stdev /= (data.n - 1);
+  stdev = sqrt(stdev);
+
+  return {mean, stdev};
+}
+
+//Lanca std::invalid_argument se nao ha valores ou caixas para o histograma
+inline void verifica_histograma(Valores data, int B) {
+  if (data.n == 0) throw std::invalid_argument("Histograma sem valores");
+  if (B <= 0) throw std::invalid_argument("Numero de caixas deve ser positivo: " + std::to_string(B));
+}
+
+template<typename Count>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram(Valores data, int B){
+  verifica_histograma(data, B);
+  double max, min;
+
+  //Acha o max e min
+  kernels().min_max(data.dados, data.n, min, max);
+
+  return box_histogram<Count>(data, B, min, max);
+}
+
+//Histograma com o minimo e o maximo dos valores ja conhecidos
+template<typename Count>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram(Valores data, int B, double min, double max) {
+  RASTREIO_ESCOPO("box_histogram");
+  verifica_histograma(data, B);
+  std::vector<Count> count(B);
+  std::vector<double> info(B + 1);
+  double box_size;
+  auto const &k = kernels();
+
+  box_size = (max - min)/B;
+  
+  //Computa a que caixa ele pertence, calculando os indices em blocos
+  int indices[256];
+  for (size_t i = 0; i < data.n; i += 256) {
+    size_t bloco = std::min<size_t>(256, data.n - i);
+    k.indices_caixas(data.dados + i, bloco, min, max, box_size, B, indices);
+    for (size_t j = 0; j < bloco; ++j) {
+      ++count[indices[j]];
+    }
+  }
+
+  //gera o vetor informacao das caixas
+  for (int i = 0; i <= B; ++i) {
+    info[i] = min + box_size*i;
+  }
+
+  return {count, info};
+}
+
+//Estatisticas e histograma dos valores, como estat_data e box_histogram
+template<typename Count>
+Estatisticas<Count> estatisticas(Valores data, int B) {
+  verifica_histograma(data, B);
+  Estatisticas<Count> r;
+  r.n = data.n;
+  auto estat = estat_data(data);
+  r.mean = estat[0];
+  r.stdev = estat[1];
+  kernels().min_max(data.dados, data.n, r.min, r.max);
+  std::tie(r.count, r.limites) = box_histogram<Count>(data, B, r.min, r.max);
+  return r;
+}
+
+//Indice da caixa de x, o maximo fica na ultima caixa
+inline int box_index(double x, double min, double max, double box_size, int B) {
+  if (x != max) return floor((x - min)/box_size);
+  return B - 1;
+}
+
+//Primeira passada do modo --stream: estatisticas sem guardar os valores
+inline Acumulador estat_stream(char const *filename) {
+  RASTREIO_ESCOPO("estat_stream");
+  Acumulador acc;
+  for_each_value(filename, [&](double x) { acc.add(x); });
+  RASTREIO_CONTA("valores", acc.n);
+  return acc;
+}
+
+//Segunda passada do modo --stream: com o minimo e o maximo ja conhecidos
+//conta os valores em cada caixa lendo o arquivo de novo
+template<typename Count>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram_stream(char const *filename, Acumulador const &acc, int B) {
+  RASTREIO_ESCOPO("box_histogram_stream");
+  std::vector<Count> count(B);
+  std::vector<double> info(B + 1);
+  double box_size = (acc.max - acc.min)/B;
+
+  for_each_value(filename, [&](double x) {
+    ++count[box_index(x, acc.min, acc.max, box_size, B)];
+  });
+
+  for (int i = 0; i <= B; ++i) {
+    info[i] = acc.min + box_size*i;
+  }
+
+  return {count, info};
+}
+
+//Divide o conteudo do arquivo em ate threads partes e chama f(leitor, i)
+//para cada parte i, cada uma em uma thread. No texto as partes terminam em
+//quebras de linha; no formato binario sao faixas de linhas da primeira coluna.
+//Uma excecao em qualquer parte (erro de leitura, falta de memoria, ...) e
+//relancada depois de todas terminarem. Se conteudo for um trecho de um
+//arquivo que comeca em inicio_arquivo, os erros de leitura tem a linha no
+//arquivo.
+template<typename F>
+void for_each_chunk_parallel(std::string_view conteudo, int threads, F f, char const *inicio_arquivo) {
+  size_t n = threads > 0 ? threads : 1;
+  std::vector<std::thread> workers;
+  std::vector<std::exception_ptr> erros(n);
+
+  //relanca o erro da primeira parte com problema
+  auto relanca = [&] {
+    for (auto &e: erros) {
+      if (e) std::rethrow_exception(e);
+    }
+  };
+
+  if (e_colunar(conteudo)) {
+    auto colunar = abre_colunar(conteudo);
+    size_t linhas = colunar.linhas();
+    for (size_t i = 0; i < n; ++i) {
+      workers.emplace_back([&, i] {
+        RASTREIO_ESCOPO("parte");
+        try {
+          LeitorColuna leitor(colunar, 0, linhas*i/n, linhas*(i + 1)/n);
+          f(leitor, i);
+        } catch (...) {
+          erros[i] = std::current_exception();
+        }
+      });
+    }
+    for (auto &w: workers) w.join();
+    relanca();
+    return;
+  }
+
+  auto partes = divide_em_linhas(conteudo, n);
+
+  for (size_t i = 0; i < partes.size(); ++i) {
+    workers.emplace_back([&, i] {
+      RASTREIO_ESCOPO("parte");
+      try {
+        LeitorNumeros leitor(partes[i]);
+        f(leitor, i);
+      } catch (ErroLeitura const &) {
+        //So no caso de erro contamos as linhas anteriores a parte, para
+        //que a mensagem tenha a linha do arquivo e nao a da parte
+        char const *inicio = inicio_arquivo ? inicio_arquivo : conteudo.data();
+        size_t linha = 1 + std::count(inicio, partes[i].data(), '\n');
+        try {
+          LeitorNumeros leitor(partes[i], linha);
+          double x;
+          while (leitor.proximo(x)) {}
+        } catch (...) {
+          erros[i] = std::current_exception();
+        }
+      } catch (...) {
+        erros[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto &w: workers) w.join();
+  relanca();
+}
+
+//Combina os resultados parciais [inicio, fim) aos pares, em arvore
+inline Acumulador merge_pairwise(std::vector<Acumulador> const &parciais, size_t inicio, size_t fim) {
+  if (fim - inicio == 0) return {};
+  if (fim - inicio == 1) return parciais[inicio];
+  size_t meio = inicio + (fim - inicio)/2;
+  auto acc = merge_pairwise(parciais, inicio, meio);
+  acc.merge(merge_pairwise(parciais, meio, fim));
+  return acc;
+}
+
+//Primeira passada do modo --threads: cada thread calcula as estatisticas da
+//sua parte do arquivo e no fim os parciais sao combinados
+inline Acumulador estat_parallel(char const *filename, int threads) {
+  RASTREIO_ESCOPO("estat_parallel");
+  ArquivoMapeado file(filename);
+  std::vector<Acumulador> parciais(threads);
+
+  for_each_chunk_parallel(file.conteudo(), threads, [&](auto &leitor, size_t i) {
+    //acumulador local para as threads nao escreverem na mesma linha de cache
+    Acumulador acc;
+    double x;
+    while (leitor.proximo(x)) acc.add(x);
+    parciais[i] = acc;
+  });
+
+  auto acc = merge_pairwise(parciais, 0, parciais.size());
+  RASTREIO_CONTA("valores", acc.n);
+  return acc;
+}
+
+//Bloco de contadores do tamanho de uma linha de cache. As caixas privadas de
+//cada thread sao feitas desses blocos, entao duas threads nunca escrevem na
+//mesma linha de cache.
+template<typename Count>
+struct alignas(64) LinhaDeCaixas {
+  static constexpr int size = 64/sizeof(Count);
+  Count count[size]{};
+};
+
+//Segunda passada do modo --threads: cada thread conta os valores da sua parte
+//do arquivo em caixas privadas e no final as caixas sao somadas
+template<typename Count>
+std::tuple<std::vector<Count>, std::vector<double>> box_histogram_parallel(char const *filename, Acumulador const &acc, int B, int threads) {
+  RASTREIO_ESCOPO("box_histogram_parallel");
+  using Linha = LinhaDeCaixas<Count>;
+  std::vector<Count> count(B);
+  std::vector<double> info(B + 1);
+  double box_size = (acc.max - acc.min)/B;
+
+  ArquivoMapeado file(filename);
+
+  //caixas privadas de todas as threads, cada uma com linhas_por_thread linhas
+  size_t linhas_por_thread = (B + Linha::size - 1)/Linha::size;
+  std::vector<Linha> privadas(threads*linhas_por_thread);
+
+  for_each_chunk_parallel(file.conteudo(), threads, [&](auto &leitor, size_t i) {
+    Linha *minhas = privadas.data() + i*linhas_por_thread;
+    double x;
+    while (leitor.proximo(x)) {
+      int k = box_index(x, acc.min, acc.max, box_size, B);
+      ++minhas[k/Linha::size].count[k%Linha::size];
+    }
+  });
+
+  //soma as caixas privadas
+  for (int t = 0; t < threads; ++t) {
+    Linha const *caixas = privadas.data() + t*linhas_por_thread;
+    for (int k = 0; k < B; ++k) {
+      count[k] += caixas[k/Linha::size].count[k%Linha::size];
+    }
+  }
+
+  for (int i = 0; i <= B; ++i) {
+    info[i] = acc.min + box_size*i;
+  }
+
+  return {count, info};
+}
+
+//Passada unica do modo --sketch: estatisticas exatas e sketch dos valores
+inline void estat_sketch(char const *filename, int threads, Acumulador &acc, Sketch &sketch) {
+  ArquivoMapeado file(filename);
+  estat_sketch_conteudo(file.conteudo(), threads, acc, sketch);
+}
+
+//Junta a acc e sketch os valores de conteudo, com um acumulador e um sketch
+//por thread juntados no final (inicio_arquivo como em for_each_chunk_parallel)
+inline void estat_sketch_conteudo(std::string_view conteudo, int threads, Acumulador &acc, Sketch &sketch, char const *inicio_arquivo) {
+  RASTREIO_ESCOPO("estat_sketch_conteudo");
+  if (threads < 1) threads = 1;
+  std::vector<Acumulador> parciais(threads);
+  std::vector<Sketch> sketches(threads, Sketch(sketch.alpha()));
+
+  for_each_chunk_parallel(conteudo, threads, [&](auto &leitor, size_t i) {
+    Acumulador a;
+    Sketch s(sketch.alpha());
+    double x;
+    while (leitor.proximo(x)) {
+      a.add(x);
+      s.add(x);
+    }
+    parciais[i] = a;
+    sketches[i] = std::move(s);
+  }, inicio_arquivo);
+
+  auto parcial = merge_pairwise(parciais, 0, parciais.size());
+  RASTREIO_CONTA("valores", parcial.n);
+  acc.merge(parcial);
+  for (auto const &s: sketches) sketch.merge(s);
+}
+
+//Escreve as estatisticas e o sketch em texto
+inline void salva_estado(std::ostream &os, Acumulador const &acc, Sketch const &sketch) {
+  os << std::setprecision(17)
+     << acc.n << " " << acc.mean << " " << acc.m2 << " " << acc.min << " " << acc.max << "\n";
+  sketch.salva(os);
+}
+
+//Le as estatisticas e o sketch escritos por salva_estado. Lanca ErroFormato
+//se eles estiverem truncados ou forem invalidos (Sketch::carrega).
+inline void carrega_estado(std::istream &is, Acumulador &acc, Sketch &sketch) {
+  if (!(is >> acc.n >> acc.mean >> acc.m2 >> acc.min >> acc.max)) throw ErroFormato("Estado truncado");
+  sketch.carrega(is);
+  if (acc.n != sketch.size()) throw ErroFormato("Estatisticas e sketch com numeros de valores diferentes");
+}
+
+//Salva as estatisticas e o sketch em um arquivo texto
+inline void salva_sketch(char const *filename, Acumulador const &acc, Sketch const &sketch) {
+  std::ofstream file(filename);
+  file << "estat-sketch 1\n";
+  salva_estado(file, acc, sketch);
+  if (!file) throw std::runtime_error(std::string("Erro escrevendo ") + filename);
+}
+
+//Junta as estatisticas e o sketch salvos em filename aos dados
+inline void carrega_sketch(char const *filename, Acumulador &acc, Sketch &sketch) {
+  std::ifstream file(filename);
+  std::string marca;
+  int versao = 0;
+  Acumulador a;
+  Sketch s;
+  try {
+    file >> marca >> versao;
+    if (marca != "estat-sketch" || versao != 1) throw ErroFormato("Nao e um sketch do estat");
+    carrega_estado(file, a, s);
+  } catch (ErroFormato const &e) {
+    throw std::runtime_error(std::string("Sketch invalido em ") + filename + ": " + e.what());
+  }
+  acc.merge(a);
+  sketch.merge(s);
+}
+
+//Hash FNV-1a de 64 bits
+inline std::uint64_t hash_bytes(std::string_view bytes) {
+  std::uint64_t h = 14695981039346656037ull;
+  for (unsigned char c: bytes) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+//Modo --cache: continua a leitura de onde a execucao anterior parou.
+//
+//O cache guarda o estado ate o fim da ultima linha completa lida. O trecho
+//depois dela (uma linha ainda sendo escrita) entra no resultado desta
+//execucao mas nao no cache, para ser lido de novo quando estiver completo.
+//Arquivos binarios colunares nao crescem por acrescimo e sao lidos inteiros.
+//
+//O arquivo e considerado reescrito, e lido inteiro de novo, se o dispositivo
+//ou o inode mudaram (um arquivo novo trocado pelo antigo), se diminuiu ou se
+//mudaram os primeiros ou os ultimos 4 KiB do trecho ja lido. Uma reescrita
+//no mesmo arquivo que so muda bytes no meio desse trecho, sem mudar o
+//tamanho dele, nao e detectada. O mtime nao ajuda: ele muda tambem a cada
+//acrescimo.
+inline void estat_incremental(char const *filename, std::string const &cache, int threads, Acumulador &acc, Sketch &sketch) {
+  RASTREIO_ESCOPO("estat_incremental");
+  ArquivoMapeado file(filename);
+  auto conteudo = file.conteudo();
+  if (e_colunar(conteudo)) {
+    estat_sketch_conteudo(conteudo, threads, acc, sketch);
+    return;
+  }
+
+  //Hashes dos primeiros e dos ultimos bytes ja lidos, que mudam se o
+  //arquivo for reescrito
+  size_t const trecho = 4096;
+  auto hash_inicio = [&](size_t fim) { return hash_bytes(conteudo.substr(0, std::min(trecho, fim))); };
+  auto hash_fim = [&](size_t fim) {
+    size_t inicio = fim > trecho ? fim - trecho : 0;
+    return hash_bytes(conteudo.substr(inicio, fim - inicio));
+  };
+
+  //Estado salvo, se ainda valer para o arquivo
+  Acumulador lido;
+  Sketch sketch_lido(sketch.alpha());
+  size_t offset = 0;
+  {
+    std::ifstream in(cache);
+    std::string marca;
+    int versao = 0;
+    std::uint64_t dispositivo = 0, inode = 0;
+    size_t offset_salvo = 0;
+    std::uint64_t h1 = 0, h2 = 0;
+    in >> marca >> versao >> dispositivo >> inode >> offset_salvo >> h1 >> h2;
+    bool valido = in && marca == "estat-cache" && versao == 2 &&
+                  dispositivo == std::uint64_t(file.info().st_dev) &&
+                  inode == std::uint64_t(file.info().st_ino) && offset_salvo <= conteudo.size() &&
+                  hash_inicio(offset_salvo) == h1 && hash_fim(offset_salvo) == h2;
+    if (valido) {
+      //um cache invalido e so descartado
+      try {
+        carrega_estado(in, lido, sketch_lido);
+        valido = sketch_lido.alpha() == sketch.alpha();
+      } catch (ErroFormato const &) {
+        valido = false;
+      }
+    }
+    if (valido) {
+      offset = offset_salvo;
+    } else {
+      lido = {};
+      sketch_lido = Sketch(sketch.alpha());
+    }
+  }
+
+  //Le as linhas completas acrescentadas desde a ultima execucao
+  size_t fim = conteudo.rfind('\n');
+  fim = fim == std::string_view::npos || fim + 1 < offset ? offset : fim + 1;
+  estat_sketch_conteudo(conteudo.substr(offset, fim - offset), threads, lido, sketch_lido, conteudo.data());
+
+  //Salva o novo estado em um arquivo temporario e troca pelo cache
+  std::string temporario = cache + ".tmp";
+  {
+    std::ofstream out(temporario);
+    out << "estat-cache 2\n" << std::uint64_t(file.info().st_dev) << " "
+        << std::uint64_t(file.info().st_ino) << "\n" << fim << " " << hash_inicio(fim) << " " << hash_fim(fim) << "\n";
+    salva_estado(out, lido, sketch_lido);
+    if (!out) throw std::runtime_error("Erro escrevendo " + temporario);
+  }
+  if (std::rename(temporario.c_str(), cache.c_str()) != 0) {
+    throw std::runtime_error("Erro escrevendo " + cache);
+  }
+
+  //Resultado: estado salvo mais a ultima linha incompleta
+  estat_sketch_conteudo(conteudo.substr(fim), 1, lido, sketch_lido, conteudo.data());
+  acc.merge(lido);
+  sketch.merge(sketch_lido);
+}
+
+//Le as colunas escolhidas de um arquivo em uma unica passada e calcula
+//estat_data e box_histogram de cada uma. Sem colunas escolhidas usa todas as
+//colunas da primeira linha com valores. A primeira linha pode ser um
+//cabecalho; as demais precisam ter todas o mesmo numero de campos, sem
+//campos vazios.
+inline std::vector<ResultadoColuna> estat_colunas(char const *filename, std::vector<size_t> colunas, char separador, int B) {
+  RASTREIO_ESCOPO("estat_colunas");
+  ArquivoMapeado file(filename);
+  auto conteudo = file.conteudo();
+  std::vector<std::vector<double>> valores;
+  //visao de cada coluna: direto do arquivo mapeado nas colunas float64 do
+  //formato colunar, ou dos valores convertidos
+  std::vector<Valores> vistas;
+
+  if (e_colunar(conteudo)) {
+    auto colunar = abre_colunar(conteudo);
+    if (colunas.empty()) {
+      for (size_t c = 1; c <= colunar.colunas(); ++c) colunas.push_back(c);
+    }
+    valores.resize(colunas.size());
+    for (size_t j = 0; j < colunas.size(); ++j) {
+      if (colunas[j] < 1 || colunas[j] > colunar.colunas()) throw ErroFormato("Coluna ausente");
+      if (auto dados = colunar.coluna_double(colunas[j] - 1)) {
+        vistas.emplace_back(dados, colunar.linhas());
+        continue;
+      }
+      LeitorColuna leitor(colunar, colunas[j] - 1, 0, colunar.linhas());
+      valores[j].reserve(colunar.linhas());
+      double x;
+      while (leitor.proximo(x)) valores[j].push_back(x);
+      vistas.emplace_back(valores[j]);
+    }
+  } else {
+    LeitorNumeros leitor(conteudo);
+    leitor.separa_por(separador);
+    std::vector<Campo> campos;
+    std::vector<double> linha;
+    bool primeira = true;
+    size_t largura = 0;
+    do {
+      leitor.campos_da_linha(campos);
+      if (campos.empty()) continue;
+
+      linha.resize(campos.size());
+      Leitura r = Leitura::ok;
+      size_t k = 0;
+      for (; k < campos.size(); ++k) {
+        r = LeitorNumeros::converte_campo(campos[k], linha[k]);
+        if (r != Leitura::ok) break;
+      }
+      // A primeira linha com campos que nao sao numeros e um cabecalho.
+      bool cabecalho = primeira && r != Leitura::ok;
+      primeira = false;
+      if (cabecalho) continue;
+      if (r != Leitura::ok) {
+        char const *msg = r == Leitura::fora_do_intervalo ? "Valor fora do intervalo"
+                          : campos[k].texto.empty()       ? "Campo vazio"
+                                                          : "Valor invalido";
+        throw ErroLeitura(msg, leitor.linha(), campos[k].coluna);
+      }
+
+      if (valores.empty()) {
+        largura = campos.size();
+        if (colunas.empty()) {
+          for (size_t c = 1; c <= largura; ++c) colunas.push_back(c);
+        }
+        for (size_t c: colunas) {
+          if (c < 1 || c > largura) {
+            throw ErroLeitura("Coluna " + std::to_string(c) + " ausente", leitor.linha(), 1);
+          }
+        }
+        valores.resize(colunas.size());
+      } else if (campos.size() != largura) {
+        throw ErroLeitura("Linha com " + std::to_string(campos.size()) + " colunas, esperadas " +
+                              std::to_string(largura),
+                          leitor.linha(), 1);
+      }
+      for (size_t j = 0; j < colunas.size(); ++j) valores[j].push_back(linha[colunas[j] - 1]);
+    } while (leitor.proxima_linha());
+  }
+
+  if (vistas.empty()) vistas.assign(valores.begin(), valores.end());
+  for (auto const &v: vistas) RASTREIO_CONTA("valores", v.n);
+
+  std::vector<ResultadoColuna> resultados(vistas.size());
+  for (size_t j = 0; j < vistas.size(); ++j) {
+    static_cast<Estatisticas<std::int64_t> &>(resultados[j]) = estatisticas<std::int64_t>(vistas[j], B);
+    resultados[j].coluna = colunas[j];
+  }
+  return resultados;
+}
+
+#endif
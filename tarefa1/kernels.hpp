@@ -0,0 +1,267 @@
+/*Kernels vetorizados usados por estat_data e box_histogram.
+
+Cada kernel tem uma versao escalar portavel e, em x86-64 com GCC/Clang,
+versoes AVX2 e AVX-512. A versao usada e escolhida uma vez, na primeira
+chamada de kernels(), de acordo com o que a CPU suporta.
+
+As versoes vetoriais somam em 4 (AVX2) ou 8 (AVX-512) somas parciais, entao
+a soma e a soma dos quadrados dos desvios diferem da versao escalar so pelo
+arredondamento. Minimo, maximo e indices das caixas sao exatamente iguais,
+tambem com NaN: como no laco escalar (max < x), um NaN e ignorado, a nao ser
+o primeiro valor, que fica como minimo e maximo. Para isso min_pd e max_pd
+recebem o valor novo primeiro, ja que devolvem o segundo operando quando um
+deles e NaN.
+*/
+
+#ifndef TAREFA1_KERNELS_HPP
+#define TAREFA1_KERNELS_HPP
+
+#include <math.h>
+#include <cstddef>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define ESTAT_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+//Conjunto de kernels de uma implementacao
+struct Kernels {
+  char const *nome;
+  //Soma dos valores
+  double (*soma)(double const *x, size_t n);
+  //Soma de (x - mean)^2
+  double (*soma_desvios)(double const *x, size_t n, double mean);
+  //Minimo e maximo, n > 0
+  void (*min_max)(double const *x, size_t n, double &min, double &max);
+  //Indice da caixa de cada valor, como em box_index
+  void (*indices_caixas)(double const *x, size_t n, double min, double max, double box_size, int B, int *k);
+};
+
+//Versao escalar portavel
+namespace kernels_escalar {
+
+inline double soma(double const *x, size_t n) {
+  double s = 0;
+  for (size_t i = 0; i < n; ++i) s += x[i];
+  return s;
+}
+
+inline double soma_desvios(double const *x, size_t n, double mean) {
+  double s = 0;
+  for (size_t i = 0; i < n; ++i) {
+    double d = x[i] - mean;
+    s += d*d;
+  }
+  return s;
+}
+
+inline void min_max(double const *x, size_t n, double &min, double &max) {
+  min = max = x[0];
+  for (size_t i = 1; i < n; ++i) {
+    if (max < x[i]) max = x[i];
+    if (min > x[i]) min = x[i];
+  }
+}
+
+inline void indices_caixas(double const *x, size_t n, double min, double max, double box_size, int B, int *k) {
+  for (size_t i = 0; i < n; ++i) {
+    k[i] = x[i] != max ? int(floor((x[i] - min)/box_size)) : B - 1;
+  }
+}
+
+}
+
+#ifdef ESTAT_KERNELS_X86
+
+//Versao AVX2, 4 doubles por vez
+namespace kernels_avx2 {
+
+__attribute__((target("avx2"))) inline double soma(double const *x, size_t n) {
+  __m256d s = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) s = _mm256_add_pd(s, _mm256_loadu_pd(x + i));
+  double p[4];
+  _mm256_storeu_pd(p, s);
+  double r = (p[0] + p[1]) + (p[2] + p[3]);
+  for (; i < n; ++i) r += x[i];
+  return r;
+}
+
+__attribute__((target("avx2"))) inline double soma_desvios(double const *x, size_t n, double mean) {
+  __m256d s = _mm256_setzero_pd();
+  __m256d m = _mm256_set1_pd(mean);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(x + i), m);
+    s = _mm256_add_pd(s, _mm256_mul_pd(d, d));
+  }
+  double p[4];
+  _mm256_storeu_pd(p, s);
+  double r = (p[0] + p[1]) + (p[2] + p[3]);
+  for (; i < n; ++i) r += (x[i] - mean)*(x[i] - mean);
+  return r;
+}
+
+__attribute__((target("avx2"))) inline void min_max(double const *x, size_t n, double &min, double &max) {
+  __m256d vmin = _mm256_set1_pd(x[0]);
+  __m256d vmax = vmin;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(x + i);
+    vmin = _mm256_min_pd(v, vmin);
+    vmax = _mm256_max_pd(v, vmax);
+  }
+  double pmin[4], pmax[4];
+  _mm256_storeu_pd(pmin, vmin);
+  _mm256_storeu_pd(pmax, vmax);
+  min = pmin[0];
+  max = pmax[0];
+  for (int j = 1; j < 4; ++j) {
+    if (max < pmax[j]) max = pmax[j];
+    if (min > pmin[j]) min = pmin[j];
+  }
+  for (; i < n; ++i) {
+    if (max < x[i]) max = x[i];
+    if (min > x[i]) min = x[i];
+  }
+}
+
+__attribute__((target("avx2"))) inline void indices_caixas(double const *x, size_t n, double min, double max, double box_size, int B, int *k) {
+  __m256d vmin = _mm256_set1_pd(min);
+  __m256d vmax = _mm256_set1_pd(max);
+  __m256d vsize = _mm256_set1_pd(box_size);
+  __m256d ultima = _mm256_set1_pd(B - 1);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(x + i);
+    __m256d c = _mm256_floor_pd(_mm256_div_pd(_mm256_sub_pd(v, vmin), vsize));
+    c = _mm256_blendv_pd(c, ultima, _mm256_cmp_pd(v, vmax, _CMP_EQ_OQ));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(k + i), _mm256_cvttpd_epi32(c));
+  }
+  kernels_escalar::indices_caixas(x + i, n - i, min, max, box_size, B, k + i);
+}
+
+}
+
+//Versao AVX-512, 8 doubles por vez.
+//Os intrinsics AVX-512 do GCC 12 geram avisos falsos de variavel nao
+//inicializada (_mm512_undefined_pd), silenciados so neste trecho.
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+namespace kernels_avx512 {
+
+//Soma das 8 somas parciais em arvore
+inline double reduz_soma(double const p[8]) {
+  return ((p[0] + p[1]) + (p[2] + p[3])) + ((p[4] + p[5]) + (p[6] + p[7]));
+}
+
+__attribute__((target("avx512f"))) inline double soma(double const *x, size_t n) {
+  __m512d s = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) s = _mm512_add_pd(s, _mm512_loadu_pd(x + i));
+  double p[8];
+  _mm512_storeu_pd(p, s);
+  double r = reduz_soma(p);
+  for (; i < n; ++i) r += x[i];
+  return r;
+}
+
+__attribute__((target("avx512f"))) inline double soma_desvios(double const *x, size_t n, double mean) {
+  __m512d s = _mm512_setzero_pd();
+  __m512d m = _mm512_set1_pd(mean);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d d = _mm512_sub_pd(_mm512_loadu_pd(x + i), m);
+    s = _mm512_add_pd(s, _mm512_mul_pd(d, d));
+  }
+  double p[8];
+  _mm512_storeu_pd(p, s);
+  double r = reduz_soma(p);
+  for (; i < n; ++i) r += (x[i] - mean)*(x[i] - mean);
+  return r;
+}
+
+__attribute__((target("avx512f"))) inline void min_max(double const *x, size_t n, double &min, double &max) {
+  __m512d vmin = _mm512_set1_pd(x[0]);
+  __m512d vmax = vmin;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d v = _mm512_loadu_pd(x + i);
+    vmin = _mm512_min_pd(v, vmin);
+    vmax = _mm512_max_pd(v, vmax);
+  }
+  double pmin[8], pmax[8];
+  _mm512_storeu_pd(pmin, vmin);
+  _mm512_storeu_pd(pmax, vmax);
+  min = pmin[0];
+  max = pmax[0];
+  for (int j = 1; j < 8; ++j) {
+    if (max < pmax[j]) max = pmax[j];
+    if (min > pmin[j]) min = pmin[j];
+  }
+  for (; i < n; ++i) {
+    if (max < x[i]) max = x[i];
+    if (min > x[i]) min = x[i];
+  }
+}
+
+__attribute__((target("avx512f"))) inline void indices_caixas(double const *x, size_t n, double min, double max, double box_size, int B, int *k) {
+  __m512d vmin = _mm512_set1_pd(min);
+  __m512d vmax = _mm512_set1_pd(max);
+  __m512d vsize = _mm512_set1_pd(box_size);
+  __m512d ultima = _mm512_set1_pd(B - 1);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512d v = _mm512_loadu_pd(x + i);
+    __m512d c = _mm512_roundscale_pd(_mm512_div_pd(_mm512_sub_pd(v, vmin), vsize),
+                                     _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+    c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(v, vmax, _CMP_EQ_OQ), c, ultima);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(k + i), _mm512_cvttpd_epi32(c));
+  }
+  kernels_escalar::indices_caixas(x + i, n - i, min, max, box_size, B, k + i);
+}
+
+}
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
+#endif
+
+inline Kernels const &kernels_escalares() {
+  static Kernels const k{"escalar", kernels_escalar::soma, kernels_escalar::soma_desvios,
+                         kernels_escalar::min_max, kernels_escalar::indices_caixas};
+  return k;
+}
+
+//Kernels AVX2 e AVX-512, ou nullptr se a CPU (ou o compilador) nao tiver
+inline Kernels const *kernels_avx2_se_houver() {
+#ifdef ESTAT_KERNELS_X86
+  static Kernels const k{"avx2", kernels_avx2::soma, kernels_avx2::soma_desvios,
+                         kernels_avx2::min_max, kernels_avx2::indices_caixas};
+  if (__builtin_cpu_supports("avx2")) return &k;
+#endif
+  return nullptr;
+}
+
+inline Kernels const *kernels_avx512_se_houver() {
+#ifdef ESTAT_KERNELS_X86
+  static Kernels const k{"avx512", kernels_avx512::soma, kernels_avx512::soma_desvios,
+                         kernels_avx512::min_max, kernels_avx512::indices_caixas};
+  if (__builtin_cpu_supports("avx512f")) return &k;
+#endif
+  return nullptr;
+}
+
+//Melhor implementacao disponivel nesta CPU, escolhida na primeira chamada
+inline Kernels const &kernels() {
+  static Kernels const &k = kernels_avx512_se_houver() ? *kernels_avx512_se_houver()
+                          : kernels_avx2_se_houver() ? *kernels_avx2_se_houver()
+                          : kernels_escalares();
+  return k;
+}
+
+#endif
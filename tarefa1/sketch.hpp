@@ -0,0 +1,314 @@
+/*Sketch de quantis com memoria limitada para o modo --sketch do estat.
+
+Os valores sao contados em caixas logaritmicas: o valor x > 0 vai para a
+caixa k = ceil(log(x)/log(gamma)), com gamma = (1 + alpha)/(1 - alpha), e o
+valor representativo da caixa fica a uma distancia relativa de no maximo
+alpha de qualquer valor contado nela. Os negativos usam uma segunda tabela
+com |x| e os valores muito proximos de zero uma contagem propria.
+
+Cada tabela tem no maximo max_caixas caixas consecutivas. Quando os valores
+ocupam mais caixas do que isso, as caixas de menor modulo sao juntadas na
+primeira caixa que ficou, perdendo precisao so nos valores mais proximos de
+zero. Dois sketches com o mesmo alpha se juntam somando as caixas, entao
+sketches de threads ou de arquivos diferentes podem ser combinados.
+*/
+
+#ifndef TAREFA1_SKETCH_HPP
+#define TAREFA1_SKETCH_HPP
+
+#include <math.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../comum/colunar.hpp"
+
+//Caixas consecutivas [offset, offset + size) de uma das tabelas do sketch
+class CaixasLog {
+  int _offset{0};
+  std::vector<std::uint64_t> _count;
+  size_t _max_caixas;
+
+  public:
+    explicit CaixasLog(size_t max_caixas) : _max_caixas{max_caixas} {}
+
+    //Soma c na caixa k, aumentando a faixa se precisar
+    void add(int k, std::uint64_t c = 1) {
+      if (_count.empty()) {
+        _offset = k;
+        _count.assign(1, 0);
+      } else if (k < _offset) {
+        //caixa menor que todas: se nao couber fica na primeira caixa
+        size_t novas = _offset - k;
+        if (_count.size() + novas > _max_caixas) {
+          novas = _max_caixas > _count.size() ? _max_caixas - _count.size() : 0;
+          k = _offset - int(novas);
+        }
+        _count.insert(_count.begin(), novas, 0);
+        _offset -= int(novas);
+      } else if (k >= _offset + int(_count.size())) {
+        //caixa maior que todas: junta as menores se passar do limite
+        size_t tamanho = k - _offset + 1;
+        if (tamanho > _max_caixas) {
+          size_t juntar = tamanho - _max_caixas;
+          if (juntar >= _count.size()) {
+            std::uint64_t total = 0;
+            for (auto x: _count) total += x;
+            _count.assign(1, total);
+            _offset = k - int(_max_caixas) + 1;
+          } else {
+            for (size_t i = 0; i < juntar; ++i) _count[juntar] += _count[i];
+            _count.erase(_count.begin(), _count.begin() + juntar);
+            _offset += int(juntar);
+          }
+          tamanho = k - _offset + 1;
+        }
+        _count.resize(tamanho, 0);
+      }
+      _count[k - _offset] += c;
+    }
+
+    int offset() const { return _offset; }
+    size_t size() const { return _count.size(); }
+    std::uint64_t operator[](size_t i) const { return _count[i]; }
+
+    //Junta as caixas de outra tabela
+    void merge(CaixasLog const &o) {
+      for (size_t i = 0; i < o.size(); ++i) {
+        if (o[i]) add(o._offset + int(i), o[i]);
+      }
+    }
+
+    void salva(std::ostream &os) const {
+      os << _offset << " " << _count.size();
+      for (auto x: _count) os << " " << x;
+      os << "\n";
+    }
+
+    //Le as caixas escritas por salva. Lanca ErroFormato se houver mais que
+    //max_caixas caixas ou alguma fora de [menor, maior].
+    void carrega(std::istream &is, int menor, int maior) {
+      long long offset;
+      size_t tamanho;
+      if (!(is >> offset >> tamanho)) throw ErroFormato("Sketch truncado");
+      if (tamanho > _max_caixas) throw ErroFormato("Sketch com caixas demais");
+      if (tamanho > 0 && (offset < menor || offset + (long long)(tamanho) - 1 > maior)) {
+        throw ErroFormato("Sketch com caixas fora da faixa");
+      }
+      _offset = int(offset);
+      //le uma caixa por vez, entao um tamanho maior que o arquivo para no fim
+      //dele em vez de alocar as caixas antes
+      _count.clear();
+      std::uint64_t x;
+      for (size_t i = 0; i < tamanho; ++i) {
+        if (!(is >> x)) throw ErroFormato("Sketch truncado");
+        _count.push_back(x);
+      }
+    }
+
+    //Soma das contagens, ou false se ela nao cabe em 64 bits
+    bool total(std::uint64_t &soma) const {
+      soma = 0;
+      for (auto x: _count) {
+        if (soma + x < soma) return false;
+        soma += x;
+      }
+      return true;
+    }
+};
+
+class Sketch {
+  double _alpha;
+  double _gamma;
+  double _log_gamma;
+  size_t _max_caixas;
+  CaixasLog _pos;
+  CaixasLog _neg;
+  std::uint64_t _zeros{0};
+  std::uint64_t _n{0};
+  double _min{0}, _max{0};
+
+  //Menor modulo que ainda vai para uma caixa logaritmica
+  static constexpr double menor = std::numeric_limits<double>::min();
+
+  int chave(double x) const { return int(ceil(log(x)/_log_gamma)); }
+  double representante(int k) const { return 2*pow(_gamma, k)/(_gamma + 1); }
+
+  public:
+    explicit Sketch(double alpha = 0.001, size_t max_caixas = 8192)
+        : _alpha{alpha}, _gamma{(1 + alpha)/(1 - alpha)},
+          _log_gamma{log(_gamma)}, _max_caixas{max_caixas},
+          _pos{max_caixas}, _neg{max_caixas} {}
+
+    void add(double x) {
+      ++_n;
+      if (_n == 1) {
+        _min = _max = x;
+      } else {
+        if (_max < x) _max = x;
+        if (_min > x) _min = x;
+      }
+      if (x >= menor) _pos.add(chave(x));
+      else if (x <= -menor) _neg.add(chave(-x));
+      else ++_zeros;
+    }
+
+    //Junta outro sketch com o mesmo alpha
+    void merge(Sketch const &o) {
+      if (o._alpha != _alpha) {
+        throw std::invalid_argument("Sketches com precisoes diferentes");
+      }
+      if (o._n == 0) return;
+      if (_n == 0) {
+        _min = o._min;
+        _max = o._max;
+      } else {
+        if (_max < o._max) _max = o._max;
+        if (_min > o._min) _min = o._min;
+      }
+      _n += o._n;
+      _zeros += o._zeros;
+      _pos.merge(o._pos);
+      _neg.merge(o._neg);
+    }
+
+    std::uint64_t size() const { return _n; }
+    double alpha() const { return _alpha; }
+
+    //Chama f(valor, contagem) para cada caixa nao vazia, em ordem crescente
+    template<typename F>
+    void for_each_caixa(F f) const {
+      for (size_t i = _neg.size(); i-- > 0;) {
+        if (_neg[i]) f(-representante(_neg.offset() + int(i)), _neg[i]);
+      }
+      if (_zeros) f(0.0, _zeros);
+      for (size_t i = 0; i < _pos.size(); ++i) {
+        if (_pos[i]) f(representante(_pos.offset() + int(i)), _pos[i]);
+      }
+    }
+
+    //Quantil q (0 <= q <= 1) aproximado, com erro relativo ate alpha
+    double quantil(double q) const {
+      if (_n == 0) return 0;
+      double posto = q*(_n - 1);
+      std::uint64_t acumulado = 0;
+      double resultado = _max;
+      bool achou = false;
+      for_each_caixa([&](double v, std::uint64_t c) {
+        if (achou) return;
+        acumulado += c;
+        if (acumulado > posto) {
+          resultado = v;
+          achou = true;
+        }
+      });
+      if (resultado < _min) return _min;
+      if (resultado > _max) return _max;
+      return resultado;
+    }
+
+    //Histograma aproximado com B caixas entre o minimo e o maximo. A contagem
+    //de cada caixa logaritmica e espalhada uniformemente pelo seu intervalo
+    //de valores; as contagens fracionarias sao arredondadas pela soma
+    //acumulada, entao o total continua igual ao numero de valores.
+    template<typename Count>
+    std::vector<Count> histograma(int B) const {
+      std::vector<double> frac(B);
+      double box_size = (_max - _min)/B;
+      auto caixa = [&](double v) {
+        int k = v < _max ? int(floor((v - _min)/box_size)) : B - 1;
+        return k < 0 ? 0 : (k >= B ? B - 1 : k);
+      };
+      for_each_intervalo([&](double lo, double hi, std::uint64_t c) {
+        if (lo < _min) lo = _min;
+        if (hi > _max) hi = _max;
+        if (!(hi > lo) || box_size == 0) {
+          frac[caixa(hi < _min ? _min : hi)] += c;
+          return;
+        }
+        //parte do intervalo [lo, hi] que cai em cada caixa do histograma
+        for (int k = caixa(lo); k <= caixa(hi); ++k) {
+          double a = std::max(lo, _min + box_size*k);
+          double b = std::min(hi, k == B - 1 ? _max : _min + box_size*(k + 1));
+          if (b > a) frac[k] += c*(b - a)/(hi - lo);
+        }
+      });
+
+      std::vector<Count> count(B);
+      double acumulado = 0;
+      Count anterior = 0;
+      for (int k = 0; k < B; ++k) {
+        acumulado += frac[k];
+        Count atual = Count(llround(acumulado));
+        count[k] = atual - anterior;
+        anterior = atual;
+      }
+      return count;
+    }
+
+    //Chama f(lo, hi, contagem) com o intervalo de valores de cada caixa nao
+    //vazia, em ordem crescente
+    template<typename F>
+    void for_each_intervalo(F f) const {
+      for (size_t i = _neg.size(); i-- > 0;) {
+        int k = _neg.offset() + int(i);
+        if (_neg[i]) f(-pow(_gamma, k), -pow(_gamma, k - 1), _neg[i]);
+      }
+      if (_zeros) f(0.0, 0.0, _zeros);
+      for (size_t i = 0; i < _pos.size(); ++i) {
+        int k = _pos.offset() + int(i);
+        if (_pos[i]) f(pow(_gamma, k - 1), pow(_gamma, k), _pos[i]);
+      }
+    }
+
+    void salva(std::ostream &os) const {
+      os << std::setprecision(17) << _alpha << " " << _max_caixas << " " << _n
+         << " " << _zeros << " " << _min << " " << _max << "\n";
+      _pos.salva(os);
+      _neg.salva(os);
+    }
+
+    //Le o sketch escrito por salva. Lanca ErroFormato se o arquivo estiver
+    //truncado ou nao for um sketch valido: alpha fora de (0, 1), mais caixas
+    //que as deste sketch, caixas que nenhum double daria ou contagens que nao
+    //somam o numero de valores.
+    void carrega(std::istream &is) {
+      double alpha;
+      size_t max_caixas;
+      if (!(is >> alpha >> max_caixas >> _n >> _zeros >> _min >> _max)) {
+        throw ErroFormato("Sketch truncado");
+      }
+      if (!(alpha > 0 && alpha < 1)) throw ErroFormato("Sketch com precisao invalida");
+      if (max_caixas == 0 || max_caixas > _max_caixas) throw ErroFormato("Sketch com caixas demais");
+      _alpha = alpha;
+      _max_caixas = max_caixas;
+      _gamma = (1 + _alpha)/(1 - _alpha);
+      _log_gamma = log(_gamma);
+      //com alpha pequeno demais as chaves nao cabem em int
+      if (log(std::numeric_limits<double>::max())/_log_gamma >= std::numeric_limits<int>::max()) {
+        throw ErroFormato("Sketch com precisao invalida");
+      }
+      int menor_chave = chave(menor);
+      int maior_chave = chave(std::numeric_limits<double>::max());
+      _pos = CaixasLog(_max_caixas);
+      _neg = CaixasLog(_max_caixas);
+      _pos.carrega(is, menor_chave, maior_chave);
+      _neg.carrega(is, menor_chave, maior_chave);
+
+      std::uint64_t pos, neg;
+      if (!_pos.total(pos) || !_neg.total(neg) || pos + neg < pos || pos + neg + _zeros < pos + neg ||
+          pos + neg + _zeros != _n) {
+        throw ErroFormato("Sketch com contagens que nao somam o numero de valores");
+      }
+      if (_n > 0 && !(_min <= _max)) throw ErroFormato("Sketch com minimo maior que o maximo");
+    }
+};
+
+#endif
@@ -1,279 +1,460 @@
-#include <cmath>
-#include <cstdlib>
-#include <fstream>
-#include <iostream>
-#include <vector>
-
-//-----------------------------------------------------------------------------
-//
-// Representing measurements with errors.
-//
-//
-
-// Class to represent an experimental measurement value.
-class Measurement {
-  private:
-    float _value; // Measured value
-    float _error; // Associated error
-  
-  public:
-    //-----------------------------------------------------------------------------
-    // Arithmetic operations on measurements.
-  
-    // Some two measurements. Evaluate error.
-    friend Measurement operator+(Measurement const &a, Measurement const &b);
-  
-    // Subtract two measurements. Evaluate error.
-    friend Measurement operator-(Measurement const &a, Measurement const &b);
-  
-    // Multiply two measurements. Evaluate error.
-    friend Measurement operator*(Measurement const &a, Measurement const &b);
-  
-    // Multiply a constant with a measurement. Evaluate error.
-    friend Measurement operator*(float a, Measurement const &b);
-  
-    // Divide two measurements. Evaluate error.
-    friend Measurement operator/(Measurement const &a, Measurement const &b);
-  
-    // Divide a measurement by a constant. Evaluate error.
-    friend Measurement operator/(Measurement const &a, float b);
-
-    friend std::ostream& operator<<(std::ostream &os, Measurement const &a){
-      os << a._value << " +- " << a._error;
-      return os;
-    }
-    Measurement(float value = 0, float error = 0) {
-      _value = value;
-      _error = error;
-    }
-};
-
-//-----------------------------------------------------------------------------
-// Type and class to represent the time and positions of the particle. With errors.
-//
-struct ParticlePosition {
-  Measurement time;   // Time
-  Measurement height; // Associated height
-};
-
-class Positions {
-  public:
-    std::vector<ParticlePosition> data;
-
-    // Reads data from filename.
-    std::vector<ParticlePosition> read_data(std::string filename);
-    // Class contructor
-    Positions(std::string _filename) {
-     data = read_data(_filename);
-    };
-};
-
-//-----------------------------------------------------------------------------
-//
-// Auxiliary classes and functions for the main function.
-//
-
-// Some useful type synonyms.
-//using Positions = std::vector<ParticlePosition>;
-
-class Compute : private Positions {
-  private:
-    // Computes the value of g given the time and height data.
-    Measurement calculate_g();
-    // Compute velocities in each instant given the data and
-    // already evaluated g.
-    std::vector<Measurement> calculate_velocities(Measurement g);
-  public:
-    Measurement g;
-    std::vector<Measurement> velocities;
-    // Class contructor
-    Compute(std::string _filename) : Positions(_filename) {
-      g = calculate_g();
-      velocities = calculate_velocities(g);
-    };
-};
-
-// Tells how to execute the code.
-void usage(std::string exename);
-
-//-----------------------------------------------------------------------------
-//
-// main
-//
-// Reads data on the trajectory of an object in free fall.
-// The name of the file is read from the command line (only argument).
-// Data is expected to consist in lines with 4 floating point values each:
-// time time-error height height-error
-//
-// The lines are from the smallest time to the largest time values.
-//
-// Evaluates and prints to standard output the gravitational acceleartion
-// and the velocities at each instant (in order).
-//
-int main(int argc, char const *argv[]) {
-  // We need an argument with the name of the data file.
-  if (argc != 2) {
-    usage(argv[0]);
-    std::exit(1);
-  }
-
-  auto data = Compute(argv[1]);
-  
-  auto g = data.g;
-  auto velocities = data.velocities;
-
-  std::cout << "Evaluated values follow.\n\n";
-  std::cout << "Gravitational acceleration: " << g << std::endl;
-  std::cout << "Velocities:\n";
-  for (size_t i = 0; i < velocities.size(); ++i) {
-    std::cout << velocities[i] << std::endl;
-  }
-
-  return 0;
-}
-
-//-----------------------------------------------------------------------------
-//
-// Implementations of the functions auxiliary to main.
-//
-
-// Tells how to execute the code.
-void usage(std::string exename) {
-  std::cerr << "Usage: " << exename << " <data file name>\n";
-}
-
-// Reads data from filename.
-// The data are in the format:
-//
-// <time> <time error> <height> <height error>.
-//
-// All are floating point numbers.
-std::vector<ParticlePosition> Positions::read_data(std::string filename) {
-
-  std::ifstream datafile(filename);
-  if (!datafile.good()) {
-    std::cerr << "Error reading " << filename << std::endl;
-    std::exit(2);
-  }
-
-  // Read a position (time+height with errors) value.
-  float value, error;
-  // Try to read until the end of the file.
-  while (datafile >> value) {
-    // If we find a value, there must be 3 more values.
-
-    datafile >> error;
-    if (datafile.fail()) {
-      std::cerr << "Error reading data from " << filename << std::endl;
-      std::exit(3);
-    }
-
-    Measurement time{value, error};
-
-    datafile >> value;
-    datafile >> error;
-    if (datafile.fail()) {
-      std::cerr << "Error reading data from " << filename << std::endl;
-      std::exit(3);
-    }
-
-    Measurement height{value, error};
-
-    data.push_back({time, height});
-  }
-
-  return data;
-}
-
-// Computes the value of g given the time and height data.
-Measurement Compute::calculate_g() {
-  // Uses the first, second and last positions and corresponding times,
-  // and compute
-  //
-  // 2 [(hn-h1)t0-(hn-h0)t1+(h1-h0)tn] / [(t1-t0)(tn-t1)(tn-t0)]
-  //
-  // (where t is time, h is height and 0, 1, n indicate first, second and last
-  // points.)
-  auto num_points = data.size();
-  auto t0 = data[0].time;
-  auto t1 = data[1].time;
-  auto tn = data[num_points - 1].time;
-  auto h0 = data[0].height;
-  auto h1 = data[1].height;
-  auto hn = data[num_points - 1].height;
-
-  auto delta_h_10 = h1 - h0;
-  auto delta_h_n0 = hn - h0;
-  auto delta_h_n1 = hn - h1;
-  auto delta_t_10 = t1 - t0;
-  auto delta_t_n0 = tn - t0;
-  auto delta_t_n1 = tn - t1;
-  auto factor1 = delta_h_n1 * t0;
-  auto factor2 = delta_h_n0 * t1;
-  auto factor3 = delta_h_10 * tn;
-  auto numerator = (factor1 - factor2) + factor3;
-  auto denominator = (delta_t_10 * delta_t_n1) * delta_t_n0;
-  return 2.0f * (numerator / denominator);
-}
-
-// Compute velocities in each instant given the data and
-// already evaluated g.
-std::vector<Measurement> Compute::calculate_velocities(Measurement g) {
-  auto const n_data = data.size();
-  std::vector<Measurement> velocities(n_data);
-
-  // For each data point (except the last, see below), evaluate the velocity as
-  // the starting velocity for a free fall to reach the next point.
-  //
-  // v = delta_h/delta_t + g*delta_t/2
-  //
-  for (size_t i = 0; i < n_data - 1; ++i) {
-    auto delta_h = data[i + 1].height - data[i].height;
-    auto delta_t = data[i + 1].time - data[i].time;
-    velocities[i] =
-        (delta_h / delta_t) + ((g * delta_t) / 2.0f);
-  }
-
-  // The last velocity is evaluated from the one before last and the value of g.
-  auto last_delta_t = data[n_data - 1].time - data[n_data - 2].time;
-  velocities[n_data - 1] = velocities[n_data - 2] - (g * last_delta_t);
-
-  return velocities;
-}
-
-//-----------------------------------------------------------------------------
-//
-// Implementation of arithmetic operations on measurements with errors.
-// The error propagation formulas assume that the error are Gaussian
-// and independent (uncorrelated) in the two measurements.
-//
-
-inline float square(float x) { return x * x; }
-
-Measurement operator+(Measurement const &a, Measurement const &b) {
-  return {a._value + b._value, std::sqrt(square(a._error) + square(b._error))};
-}
-
-Measurement operator-(Measurement const &a, Measurement const &b) {
-  return {a._value - b._value, std::sqrt(square(a._error) + square(b._error))};
-}
-
-Measurement operator*(Measurement const &a, Measurement const &b) {
-  auto _value = a._value * b._value;
-  return {_value, std::fabs(_value) * std::sqrt(square(a._error / a._value) +
-                                              square(b._error / b._value))};
-}
-
-Measurement operator*(float a, Measurement const &b) {
-  return {a * b._value, std::fabs(a) * b._error};
-}
-
-Measurement operator/(Measurement const &a, Measurement const &b) {
-  auto _value = a._value / b._value;
-  return {_value, std::fabs(_value) * std::sqrt(square(a._error / a._value) +
-                                              square(b._error / b._value))};
-}
-
-Measurement operator/(Measurement const &a, float b) {
-  return {a._value / b, a._error / std::fabs(b)};
-}
+// Build: g++ -std=c++17 -O3 -fno-math-errno -pthread queda.cpp -o queda
+// (-fno-math-errno lets the compiler vectorize the sqrt in the
+// MeasurementArray loops.)
+//
+// Command line interface of queda; the computations are in queda.hpp.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "queda.hpp"
+
+//-----------------------------------------------------------------------------
+//
+// Auxiliary functions for the main function.
+//
+
+// Tells how to execute the code.
+void usage(std::string exename);
+
+// Prints the bad lines skipped in filename, if any, to standard error.
+void print_skipped(std::string const &filename, ReadReport const &report);
+
+// Throws InvalidDataError if filename has too few positions (n) to fit g.
+void check_enough_positions(std::string const &filename, std::size_t n);
+
+// main for positions stored as S and velocities computed in A.
+template<typename S, typename A>
+int queda_main(int argc, char const *argv[]);
+
+// Chooses the precision of the velocity arithmetic and calls queda_main.
+template<typename S>
+int queda_main_storing(std::string const &accumulate, int argc, char const *argv[]);
+
+// Streaming mode of main (--stream).
+template<typename S, typename A>
+int stream_main(std::string const &filename, std::size_t calibration, BadLines bad_lines);
+
+// Batch mode of main (--batch).
+template<typename S, typename A>
+int batch_main(int argc, char const *argv[]);
+
+//-----------------------------------------------------------------------------
+//
+// main
+//
+// Reads data on the trajectory of an object in free fall.
+// The name of the file is read from the command line.
+// Data is expected to consist in lines with 4 floating point values each:
+// time time-error height height-error
+// The file may also be in the binary columnar format produced by
+// comum/converte.cpp, which is detected automatically.
+//
+// The lines are from the smallest time to the largest time values.
+//
+// Evaluates and prints to standard output the gravitational acceleartion
+// and the velocities at each instant (in order).
+//
+// With --stream the positions are not all kept in memory: each velocity is
+// printed as soon as the next position is read (see VelocityStream), using g
+// fitted to the first N positions (--calibration N, default 1000) or, with
+// --online, the fit of the positions read so far. The fit over all positions
+// is printed at the end. With up to N positions it is the same as without
+// --stream; with more it is an approximation, since each position after the
+// first N is weighted with the slope of the positions before it instead of
+// the slope of the final fit, which would need a second pass over the data.
+//
+// Lines that are not a valid position make queda fail with all of them
+// listed (exit code 3; 2 if the file cannot be read). With --skip-bad-lines
+// they are skipped instead, and listed on standard error.
+// Fewer than 3 valid positions are not enough to fit g (exit code 3).
+//
+// With --correlated the errors are propagated with all their correlations
+// (see TrackedMeasurement): g gets the linearized error of the fit with both
+// time and height errors, and each velocity an error that accounts for the
+// shared delta_t and for its correlation with g.
+//
+// Batch mode:
+//   queda --batch [--threads N] [--manifest F] [--velocities] [--correlated]
+//                 [--skip-bad-lines] [--output F] <files or directories...>
+// Processes many trajectory files, given directly, as all the files in a
+// directory or listed one per line in a manifest. The files are split among
+// N threads (default: one per core), each running Compute on one file at a
+// time. The results go to a single tab separated table with one line per
+// file (g, its error and the fit residuals; with --velocities also all the
+// velocities, separated by commas), followed by a "(fleet)" line with the
+// weighted mean of g over all files. --correlated and --skip-bad-lines work
+// as in the single file mode; a file that cannot be used is reported and
+// left out, and the exit code is that of the worst file.
+//
+// Precision, in any mode:
+//   --storage half|float|double   scalar type the positions and velocities
+//                                 are kept in (default float)
+//   --accumulate float|double     scalar type of the velocity arithmetic
+//                                 (default float)
+// Text is parsed in double for double storage and in float otherwise. The
+// fit of g always accumulates in double (see QuadraticFit).
+//
+// Tracing, in any mode:
+//   --trace F    writes a Chrome trace (chrome://tracing or ui.perfetto.dev)
+//                with the time spent parsing, fitting and computing the
+//                velocities of each file to F
+//   --metrics    writes a summary of those times and of the number of
+//                positions and bad lines read to standard error
+// (see comum/rastreio.hpp).
+//
+int main(int argc, char const *argv[]) {
+  // Output is written through the stream buffer, without flushing every line.
+  std::ios::sync_with_stdio(false);
+
+  // The precision options are taken out here; the other arguments go on to
+  // queda_main.
+  std::string storage = "float", accumulate = "float";
+  std::vector<char const *> all(argv, argv + argc);
+  rastreio::Sessao trace(all);
+  std::vector<char const *> args;
+  for (std::size_t i = 0; i < all.size(); ++i) {
+    std::string arg = all[i];
+    if (arg == "--storage" && i + 1 < all.size()) {
+      storage = all[++i];
+    } else if (arg == "--accumulate" && i + 1 < all.size()) {
+      accumulate = all[++i];
+    } else {
+      args.push_back(all[i]);
+    }
+  }
+  int n_args = int(args.size());
+
+  try {
+    if (storage == "float") return queda_main_storing<float>(accumulate, n_args, args.data());
+    if (storage == "double") return queda_main_storing<double>(accumulate, n_args, args.data());
+#ifdef QUEDA_HAS_HALF
+    if (storage == "half") return queda_main_storing<half>(accumulate, n_args, args.data());
+#endif
+  } catch (FileReadError const &e) {
+    std::cerr << "Error reading " << e.filename() << std::endl;
+    return 2;
+  } catch (InvalidDataError const &e) {
+    std::cerr << "Error reading data from " << e.filename() << ": " << e.what() << std::endl;
+    return 3;
+  }
+  usage(argv[0]);
+  return 1;
+}
+
+template<typename S>
+int queda_main_storing(std::string const &accumulate, int argc, char const *argv[]) {
+  if (accumulate == "float") return queda_main<S, float>(argc, argv);
+  if (accumulate == "double") return queda_main<S, double>(argc, argv);
+  usage(argv[0]);
+  return 1;
+}
+
+template<typename S, typename A>
+int queda_main(int argc, char const *argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--batch") return batch_main<S, A>(argc, argv);
+
+  std::string filename;
+  bool stream = false, correlated = false;
+  auto bad_lines = BadLines::fail;
+  std::size_t calibration = 1000;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--stream") {
+      stream = true;
+    } else if (arg == "--skip-bad-lines") {
+      bad_lines = BadLines::skip;
+    } else if (arg == "--correlated") {
+      correlated = true;
+    } else if (arg == "--online") {
+      calibration = 0;
+    } else if (arg == "--calibration" && i + 1 < argc) {
+      calibration = std::stoul(argv[++i]);
+      if (calibration < 3) calibration = 3;
+    } else if (filename.empty() && arg.size() > 0 && arg[0] != '-') {
+      filename = arg;
+    } else {
+      usage(argv[0]);
+      std::exit(1);
+    }
+  }
+  // We need an argument with the name of the data file.
+  if (filename.empty() || (stream && correlated)) {
+    usage(argv[0]);
+    std::exit(1);
+  }
+
+  if (stream) return stream_main<S, A>(filename, calibration, bad_lines);
+
+  Positions<S> positions;
+  print_skipped(filename, positions.read_data(filename, bad_lines));
+  check_enough_positions(filename, positions.size());
+  auto data = Compute<S, A>(std::move(positions));
+
+  auto g = data.g;
+  auto const &velocities = data.velocities;
+
+  RASTREIO_ESCOPO("output");
+  std::cout << "Evaluated values follow.\n\n";
+  if (correlated) {
+    auto result = data.calculate_correlated();
+    std::cout << "Gravitational acceleration: " << result.g << '\n';
+    std::cout << "Fit chi2/dof: " << data.fit.chi2 << " / " << data.fit.dof
+              << ", RMS residual: " << data.fit.rms_residual << '\n';
+    std::cout << "Velocities:\n";
+    for (auto const &v: result.velocities) std::cout << v << '\n';
+    return 0;
+  }
+  std::cout << "Gravitational acceleration: " << g << '\n';
+  std::cout << "Fit chi2/dof: " << data.fit.chi2 << " / " << data.fit.dof
+            << ", RMS residual: " << data.fit.rms_residual << '\n';
+  std::cout << "Velocities:\n";
+  for (size_t i = 0; i < velocities.size(); ++i) {
+    std::cout << velocities[i] << '\n';
+  }
+
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementations of the functions auxiliary to main.
+//
+
+// Tells how to execute the code.
+void usage(std::string exename) {
+  std::cerr << "Usage: " << exename
+            << " [--skip-bad-lines] [--correlated | --stream [--calibration N | --online]]"
+               " <data file name>\n"
+            << "       " << exename
+            << " --batch [--threads N] [--manifest F] [--velocities] [--correlated]"
+               " [--skip-bad-lines] [--output F]"
+               " <files or directories...>\n"
+            << "Precision options: [--storage half|float|double] [--accumulate float|double]\n"
+            << "Tracing options: [--trace F] [--metrics]\n";
+}
+
+template<typename S, typename A>
+int stream_main(std::string const &filename, std::size_t calibration, BadLines bad_lines) {
+  VelocityStream<S, A> velocities(std::cout, calibration);
+  // Nothing is written before there are enough positions for a fit, so that
+  // a file with fewer than 3 only gets the error.
+  auto report = parse_positions<arithmetic_t<S>>(
+      filename,
+      [&](auto const &p) {
+        if (velocities.size() == 2) {
+          std::cout << "Evaluated values follow.\n\n";
+          if (calibration == 0) {
+            std::cout << "Gravitational acceleration: online estimate\n";
+          }
+        }
+        velocities.add(p);
+      },
+      bad_lines);
+  print_skipped(filename, report);
+  check_enough_positions(filename, velocities.size());
+  velocities.finish();
+
+  auto fit = velocities.fit();
+  std::cout << "Gravitational acceleration (all points): " << Measurement<A>(fit.g) << '\n';
+  std::cout << "Fit chi2/dof: " << fit.chi2 << " / " << fit.dof
+            << ", RMS residual: " << fit.rms_residual << '\n';
+  return 0;
+}
+
+void print_skipped(std::string const &filename, ReadReport const &report) {
+  if (report.bad_lines == 0) return;
+  std::cerr << "Skipped " << report.bad_lines << " bad line" << (report.bad_lines > 1 ? "s" : "")
+            << " in " << filename << ":\n";
+  for (auto const &bad: report.listed) {
+    std::cerr << "  line " << bad.line;
+    if (bad.column > 0) std::cerr << ", column " << bad.column;
+    std::cerr << ": " << bad.reason << '\n';
+  }
+  if (report.bad_lines > report.listed.size()) std::cerr << "  ...\n";
+}
+
+void check_enough_positions(std::string const &filename, std::size_t n) {
+  if (n >= 3) return;
+  ReadReport report;
+  report.add({0, 0, "fewer than 3 points"});
+  throw InvalidDataError(filename, std::move(report));
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of the batch mode.
+//
+
+// Adds filename to files, or all the regular files in it (in name order) if
+// it is a directory.
+void add_batch_files(std::string const &filename, std::vector<std::string> &files) {
+  namespace fs = std::filesystem;
+  if (!fs::is_directory(filename)) {
+    files.push_back(filename);
+    return;
+  }
+  std::vector<std::string> in_directory;
+  for (auto const &entry: fs::directory_iterator(filename)) {
+    if (entry.is_regular_file()) in_directory.push_back(entry.path().string());
+  }
+  std::sort(in_directory.begin(), in_directory.end());
+  files.insert(files.end(), in_directory.begin(), in_directory.end());
+}
+
+template<typename S, typename A>
+int batch_main(int argc, char const *argv[]) {
+  int threads = std::thread::hardware_concurrency();
+  bool write_velocities = false, correlated = false;
+  auto bad_lines = BadLines::fail;
+  std::string output;
+  std::vector<std::string> files;
+  for (int i = 2; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--threads" && i + 1 < argc) {
+      threads = std::stoi(argv[++i]);
+    } else if (arg == "--velocities") {
+      write_velocities = true;
+    } else if (arg == "--correlated") {
+      correlated = true;
+    } else if (arg == "--skip-bad-lines") {
+      bad_lines = BadLines::skip;
+    } else if (arg == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "--manifest" && i + 1 < argc) {
+      std::ifstream manifest(argv[++i]);
+      if (!manifest) {
+        std::cerr << "Error reading " << argv[i] << std::endl;
+        return 2;
+      }
+      std::string line;
+      while (std::getline(manifest, line)) {
+        if (!line.empty()) add_batch_files(line, files);
+      }
+    } else {
+      add_batch_files(arg, files);
+    }
+  }
+  if (threads < 1) threads = 1;
+  if (files.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Each thread takes the next file not yet processed.
+  std::vector<FitResult> fits(files.size());
+  std::vector<std::size_t> points(files.size(), 0);
+  std::vector<MeasurementArray<S>> velocities(write_velocities ? files.size() : 0);
+  std::vector<std::string> errors(files.size());
+  std::vector<ReadReport> reports(files.size());
+  std::vector<int> codes(files.size(), 0);
+  std::atomic<std::size_t> next{0};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      for (std::size_t i = next++; i < files.size(); i = next++) {
+        RASTREIO_ESCOPO("file");
+        try {
+          Positions<S> positions;
+          reports[i] = positions.read_data(files[i], bad_lines);
+          check_enough_positions(files[i], positions.size());
+          Compute<S, A> data(std::move(positions));
+          fits[i] = data.fit;
+          points[i] = data.size();
+          if (correlated) {
+            auto result = data.calculate_correlated();
+            fits[i].g = result.g;
+            if (write_velocities) {
+              velocities[i].reserve(result.velocities.size());
+              for (auto const &v: result.velocities) velocities[i].push_back(v);
+            }
+          } else if (write_velocities) {
+            velocities[i] = std::move(data.velocities);
+          }
+        } catch (FileReadError const &e) {
+          errors[i] = "Error reading " + files[i];
+          codes[i] = 2;
+        } catch (InvalidDataError const &e) {
+          errors[i] = "Error reading data from " + files[i] + ": " + e.what();
+          codes[i] = 3;
+        } catch (std::exception const &e) {
+          // Anything else (out of memory, ...) fails this file only.
+          errors[i] = "Error processing " + files[i] + ": " + e.what();
+          codes[i] = 3;
+        }
+      }
+    });
+  }
+  for (auto &w: workers) w.join();
+
+  RASTREIO_ESCOPO("output");
+  std::ofstream output_file;
+  if (!output.empty()) {
+    output_file.open(output);
+    if (!output_file) {
+      std::cerr << "Error writing " << output << std::endl;
+      return 2;
+    }
+  }
+  std::ostream &os = output.empty() ? std::cout : output_file;
+
+  // The fleet-wide g is the mean of the g of each file weighted by
+  // 1/error^2; its chi2 measures how consistent the files are.
+  double sum_w = 0, sum_wg = 0, sum_wgg = 0;
+  std::size_t total_points = 0, used = 0;
+  int code = 0;
+  os << std::setprecision(9);
+  os << "file\tpoints\tg\tg_error\tchi2\tdof\trms_residual";
+  if (write_velocities) os << "\tvelocities";
+  os << '\n';
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    print_skipped(files[i], reports[i]);
+    if (codes[i]) {
+      std::cerr << errors[i] << std::endl;
+      code = std::max(code, codes[i]);
+      continue;
+    }
+    auto const &fit = fits[i];
+    os << files[i] << '\t' << points[i] << '\t' << fit.g.value() << '\t'
+       << fit.g.error() << '\t' << fit.chi2 << '\t' << fit.dof << '\t'
+       << fit.rms_residual;
+    if (write_velocities) {
+      os << '\t';
+      for (std::size_t k = 0; k < velocities[i].size(); ++k) {
+        os << (k ? "," : "") << velocities[i][k].value() << ':' << velocities[i][k].error();
+      }
+    }
+    os << '\n';
+
+    total_points += points[i];
+    double error = fit.g.error();
+    if (error > 0 && std::isfinite(fit.g.value())) {
+      double w = 1 / (error * error);
+      sum_w += w;
+      sum_wg += w * fit.g.value();
+      sum_wgg += w * fit.g.value() * fit.g.value();
+      ++used;
+    }
+  }
+
+  if (used > 0) {
+    double mean = sum_wg / sum_w;
+    double chi2 = std::fmax(0.0, sum_wgg - sum_wg * mean);
+    os << "(fleet)\t" << total_points << '\t' << mean << '\t' << 1 / std::sqrt(sum_w)
+       << '\t' << chi2 << '\t' << used - 1 << "\t-";
+    if (write_velocities) os << "\t-";
+    os << '\n';
+  }
+
+  return code;
+}
@@ -0,0 +1,1543 @@
+/*Library of queda: measurements with errors and their arithmetic, reading
+trajectory files and the computations on a trajectory (fit of g and
+velocities), without any of the command line handling of queda.cpp.
+
+The computations take the times and heights as spans (MeasurementSpan) and
+return result structs, so they can be called in-process on data already in
+memory: fit_trajectory, trajectory_velocities, correlated_trajectory and
+analyze_trajectory (which throw std::invalid_argument if the time and height
+spans have different sizes). Positions and Compute read a file first (throwing
+FileReadError or InvalidDataError), and VelocityStream computes the
+velocities of a stream of positions.
+
+Parsing and the computations are timed with comum/rastreio.hpp (scopes named
+after the functions and the counters "positions" and "bad_lines"), which
+only costs something when tracing is on.
+*/
+
+#ifndef TAREFA2_QUEDA_HPP
+#define TAREFA2_QUEDA_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../comum/colunar.hpp"
+#include "../comum/leitura.hpp"
+#include "../comum/rastreio.hpp"
+
+//-----------------------------------------------------------------------------
+//
+// Scalar types.
+//
+// Measurements are templates over the scalar type of the value and the error.
+// Arrays of measurements may also be stored in half precision (where the
+// compiler has _Float16); arithmetic on half precision values is done in
+// float.
+//
+
+#ifdef __FLT16_MAX__
+#define QUEDA_HAS_HALF 1
+using half = _Float16;
+#endif
+
+// Scalar used for the arithmetic on values stored as T.
+template<typename T> struct arithmetic { using type = T; };
+#ifdef QUEDA_HAS_HALF
+template<> struct arithmetic<half> { using type = float; };
+#endif
+template<typename T> using arithmetic_t = typename arithmetic<T>::type;
+
+// Type of an argument that does not take part in template argument deduction
+// (as the float constant in 2.0f * m, with m a Measurement<double>).
+template<typename T> struct no_deduce { using type = T; };
+template<typename T> using no_deduce_t = typename no_deduce<T>::type;
+
+//-----------------------------------------------------------------------------
+//
+// Representing measurements with errors.
+//
+//
+
+template<typename T> class Measurement;
+template<typename T> struct MeasurementSpan;
+template<typename T> class MeasurementArray;
+
+template<typename T> Measurement<T> operator+(Measurement<T> const &a, Measurement<T> const &b);
+template<typename T> Measurement<T> operator-(Measurement<T> const &a, Measurement<T> const &b);
+template<typename T> Measurement<T> operator*(Measurement<T> const &a, Measurement<T> const &b);
+template<typename T> Measurement<T> operator*(no_deduce_t<T> a, Measurement<T> const &b);
+template<typename T> Measurement<T> operator/(Measurement<T> const &a, Measurement<T> const &b);
+template<typename T> Measurement<T> operator/(Measurement<T> const &a, no_deduce_t<T> b);
+
+// Class to represent an experimental measurement value, of scalar type T.
+template<typename T>
+class Measurement {
+  private:
+    T _value; // Measured value
+    T _error; // Associated error
+
+  public:
+    //-----------------------------------------------------------------------------
+    // Arithmetic operations on measurements.
+
+    // Some two measurements. Evaluate error.
+    friend Measurement operator+<T>(Measurement const &a, Measurement const &b);
+
+    // Subtract two measurements. Evaluate error.
+    friend Measurement operator-<T>(Measurement const &a, Measurement const &b);
+
+    // Multiply two measurements. Evaluate error.
+    friend Measurement operator*<T>(Measurement const &a, Measurement const &b);
+
+    // Multiply a constant with a measurement. Evaluate error.
+    friend Measurement operator*<T>(no_deduce_t<T> a, Measurement const &b);
+
+    // Divide two measurements. Evaluate error.
+    friend Measurement operator/<T>(Measurement const &a, Measurement const &b);
+
+    // Divide a measurement by a constant. Evaluate error.
+    friend Measurement operator/<T>(Measurement const &a, no_deduce_t<T> b);
+
+    friend std::ostream& operator<<(std::ostream &os, Measurement const &a){
+      os << a._value << " +- " << a._error;
+      return os;
+    }
+    Measurement(T value = 0, T error = 0) {
+      _value = value;
+      _error = error;
+    }
+    // Conversion from a measurement of another precision.
+    template<typename U>
+    explicit Measurement(Measurement<U> const &m) : Measurement(T(m.value()), T(m.error())) {}
+
+    // Measured value and its error.
+    T value() const { return _value; }
+    T error() const { return _error; }
+};
+
+//-----------------------------------------------------------------------------
+//
+// Arrays of measurements stored as structure of arrays: all values in one
+// aligned array and all errors in another, so the elementwise operations
+// below run as plain loops over contiguous scalars that the compiler can
+// vectorize.
+//
+
+// Allocator for 64-byte (cache line) aligned storage.
+template<typename T>
+struct AlignedAllocator {
+  using value_type = T;
+  static constexpr std::size_t alignment = 64;
+
+  AlignedAllocator() = default;
+  template<typename U> AlignedAllocator(AlignedAllocator<U> const &) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+  }
+  void deallocate(T *p, std::size_t) {
+    ::operator delete(p, std::align_val_t(alignment));
+  }
+
+  friend bool operator==(AlignedAllocator const &, AlignedAllocator const &) { return true; }
+  friend bool operator!=(AlignedAllocator const &, AlignedAllocator const &) { return false; }
+};
+
+// Read-only view of a contiguous range of measurements in SoA form.
+template<typename T>
+struct MeasurementSpan {
+  T const *values;
+  T const *errors;
+  std::size_t size;
+
+  // View without the first n elements.
+  MeasurementSpan drop_front(std::size_t n) const {
+    return {values + n, errors + n, size - n};
+  }
+  // View of the first n elements.
+  MeasurementSpan first(std::size_t n) const { return {values, errors, n}; }
+  // Element i, as a measurement of arithmetic_t<T>.
+  Measurement<arithmetic_t<T>> operator[](std::size_t i) const { return {values[i], errors[i]}; }
+};
+
+// Array of measurements stored with scalar type T. Elements are read and
+// written as measurements of arithmetic_t<T>.
+template<typename T>
+class MeasurementArray {
+  private:
+    std::vector<T, AlignedAllocator<T>> _values;
+    std::vector<T, AlignedAllocator<T>> _errors;
+
+  public:
+    using element = Measurement<arithmetic_t<T>>;
+
+    explicit MeasurementArray(std::size_t n = 0) : _values(n), _errors(n) {}
+
+    std::size_t size() const { return _values.size(); }
+    void reserve(std::size_t n) {
+      _values.reserve(n);
+      _errors.reserve(n);
+    }
+    template<typename U>
+    void push_back(Measurement<U> const &m) {
+      _values.push_back(T(m.value()));
+      _errors.push_back(T(m.error()));
+    }
+
+    element operator[](std::size_t i) const { return {_values[i], _errors[i]}; }
+    template<typename U>
+    void set(std::size_t i, Measurement<U> const &m) {
+      _values[i] = T(m.value());
+      _errors[i] = T(m.error());
+    }
+
+    T *values() { return _values.data(); }
+    T *errors() { return _errors.data(); }
+    T const *values() const { return _values.data(); }
+    T const *errors() const { return _errors.data(); }
+
+    MeasurementSpan<T> span() const { return {_values.data(), _errors.data(), size()}; }
+    operator MeasurementSpan<T>() const { return span(); }
+};
+
+//-----------------------------------------------------------------------------
+// Elementwise arithmetic on measurement arrays, with the same error
+// propagation as the operations on single measurements. Both operands must
+// have the same size.
+
+template<typename T> MeasurementArray<T> operator+(MeasurementSpan<T> a, MeasurementSpan<T> b);
+template<typename T> MeasurementArray<T> operator-(MeasurementSpan<T> a, MeasurementSpan<T> b);
+template<typename T> MeasurementArray<T> operator*(MeasurementSpan<T> a, MeasurementSpan<T> b);
+// Multiply a single measurement with each element.
+template<typename T>
+MeasurementArray<T> operator*(Measurement<arithmetic_t<T>> const &a, MeasurementSpan<T> b);
+template<typename T>
+MeasurementArray<T> operator*(no_deduce_t<arithmetic_t<T>> a, MeasurementSpan<T> b);
+template<typename T> MeasurementArray<T> operator/(MeasurementSpan<T> a, MeasurementSpan<T> b);
+template<typename T>
+MeasurementArray<T> operator/(MeasurementSpan<T> a, no_deduce_t<arithmetic_t<T>> b);
+
+//-----------------------------------------------------------------------------
+//
+// Lazy measurement expressions.
+//
+// Wrapping operands with lazy() builds an expression tree instead of a value.
+// Each node computes the value and the variance (error squared) of its result,
+// so propagating errors needs no square roots in the middle of the
+// expression. evaluate() then takes a single sqrt per result:
+//
+//   a + b, a - b:  var = var_a + var_b
+//   a * b:         var = b^2 var_a + a^2 var_b
+//   a / b:         var = (var_a + (a/b)^2 var_b) / b^2
+//   c * a, a / c:  var = c^2 var_a, var_a / c^2
+//
+// These are the same formulas as the operators on Measurement, rewritten in
+// terms of variances. Results agree with the operator-by-operator evaluation
+// up to float rounding: within a relative difference of 1e-5 in the values
+// and the errors on the test data. When an operand of a product or division
+// has zero value, the operators give a NaN error and the lazy version the
+// finite limit.
+//
+// lazy<A>(x) computes in the scalar type A (by default the arithmetic type of
+// x). All the leaves of an expression must use the same A.
+//
+
+// Value and variance of a node for one element.
+template<typename A>
+struct Partial {
+  A value;
+  A variance;
+};
+
+// A single measurement, the same for every element.
+template<typename A>
+struct MeasurementLeaf {
+  Partial<A> p;
+  Partial<A> operator()(std::size_t) const { return p; }
+};
+
+// The elements of a measurement array stored as T.
+template<typename T, typename A>
+struct SpanLeaf {
+  MeasurementSpan<T> s;
+  Partial<A> operator()(std::size_t i) const {
+    A error = A(s.errors[i]);
+    return {A(s.values[i]), error * error};
+  }
+};
+
+template<typename T> struct is_measurement_expr : std::false_type {};
+template<typename A> struct is_measurement_expr<MeasurementLeaf<A>> : std::true_type {};
+template<typename T, typename A> struct is_measurement_expr<SpanLeaf<T, A>> : std::true_type {};
+
+template<typename A, typename B, typename R = void>
+using enable_if_exprs =
+    std::enable_if_t<is_measurement_expr<A>::value && is_measurement_expr<B>::value, R>;
+template<typename A, typename R = void>
+using enable_if_expr = std::enable_if_t<is_measurement_expr<A>::value, R>;
+
+template<typename A, typename B>
+struct SumExpr {
+  A a;
+  B b;
+  auto operator()(std::size_t i) const {
+    auto x = a(i), y = b(i);
+    return decltype(x){x.value + y.value, x.variance + y.variance};
+  }
+};
+
+template<typename A, typename B>
+struct DifferenceExpr {
+  A a;
+  B b;
+  auto operator()(std::size_t i) const {
+    auto x = a(i), y = b(i);
+    return decltype(x){x.value - y.value, x.variance + y.variance};
+  }
+};
+
+template<typename A, typename B>
+struct ProductExpr {
+  A a;
+  B b;
+  auto operator()(std::size_t i) const {
+    auto x = a(i), y = b(i);
+    return decltype(x){x.value * y.value,
+                       y.value * y.value * x.variance + x.value * x.value * y.variance};
+  }
+};
+
+template<typename A, typename B>
+struct QuotientExpr {
+  A a;
+  B b;
+  auto operator()(std::size_t i) const {
+    auto x = a(i), y = b(i);
+    auto q = x.value / y.value;
+    return decltype(x){q, (x.variance + q * q * y.variance) / (y.value * y.value)};
+  }
+};
+
+// Constant times expression, and expression divided by a constant.
+template<typename A>
+struct ScaleExpr {
+  float c;
+  A a;
+  auto operator()(std::size_t i) const {
+    auto x = a(i);
+    return decltype(x){c * x.value, c * c * x.variance};
+  }
+};
+
+template<typename A>
+struct DivideByExpr {
+  A a;
+  float c;
+  auto operator()(std::size_t i) const {
+    auto x = a(i);
+    return decltype(x){x.value / c, x.variance / (c * c)};
+  }
+};
+
+template<typename A, typename B> struct is_measurement_expr<SumExpr<A, B>> : std::true_type {};
+template<typename A, typename B> struct is_measurement_expr<DifferenceExpr<A, B>> : std::true_type {};
+template<typename A, typename B> struct is_measurement_expr<ProductExpr<A, B>> : std::true_type {};
+template<typename A, typename B> struct is_measurement_expr<QuotientExpr<A, B>> : std::true_type {};
+template<typename A> struct is_measurement_expr<ScaleExpr<A>> : std::true_type {};
+template<typename A> struct is_measurement_expr<DivideByExpr<A>> : std::true_type {};
+
+// A if given, otherwise the arithmetic type of T.
+template<typename A, typename T>
+using lazy_scalar_t = std::conditional_t<std::is_void<A>::value, arithmetic_t<T>, A>;
+
+template<typename A = void, typename T>
+MeasurementLeaf<lazy_scalar_t<A, T>> lazy(Measurement<T> const &m) {
+  using S = lazy_scalar_t<A, T>;
+  S error = S(m.error());
+  return {{S(m.value()), error * error}};
+}
+template<typename A = void, typename T>
+SpanLeaf<T, lazy_scalar_t<A, T>> lazy(MeasurementSpan<T> s) { return {s}; }
+
+template<typename A, typename B>
+enable_if_exprs<A, B, SumExpr<A, B>> operator+(A const &a, B const &b) { return {a, b}; }
+template<typename A, typename B>
+enable_if_exprs<A, B, DifferenceExpr<A, B>> operator-(A const &a, B const &b) { return {a, b}; }
+template<typename A, typename B>
+enable_if_exprs<A, B, ProductExpr<A, B>> operator*(A const &a, B const &b) { return {a, b}; }
+template<typename A, typename B>
+enable_if_exprs<A, B, QuotientExpr<A, B>> operator/(A const &a, B const &b) { return {a, b}; }
+template<typename A>
+enable_if_expr<A, ScaleExpr<A>> operator*(float c, A const &a) { return {c, a}; }
+template<typename A>
+enable_if_expr<A, DivideByExpr<A>> operator/(A const &a, float c) { return {a, c}; }
+
+// Scalar type an expression computes in.
+template<typename E>
+using expr_scalar_t = decltype(std::declval<E const &>()(0).value);
+
+// Evaluates a scalar expression (one built only from single measurements).
+template<typename E>
+enable_if_expr<E, Measurement<expr_scalar_t<E>>> evaluate(E const &e) {
+  auto r = e(0);
+  return {r.value, std::sqrt(r.variance)};
+}
+
+// Evaluates elements [0, n) of an expression into a new array stored as T
+// (by default the scalar type of the expression).
+template<typename T = void, typename E>
+enable_if_expr<E, MeasurementArray<std::conditional_t<std::is_void<T>::value, expr_scalar_t<E>, T>>>
+evaluate(std::size_t n, E const &e) {
+  using S = std::conditional_t<std::is_void<T>::value, expr_scalar_t<E>, T>;
+  MeasurementArray<S> r(n);
+  S *__restrict rv = r.values();
+  S *__restrict re = r.errors();
+  for (std::size_t i = 0; i < n; ++i) {
+    auto x = e(i);
+    rv[i] = S(x.value);
+    re[i] = S(std::sqrt(x.variance));
+  }
+  return r;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Correlated error propagation.
+//
+// The operators on Measurement treat their operands as independent, which is
+// wrong when both depend on the same samples: delta_t appears twice in each
+// velocity, and g is fitted to all the positions. TrackedMeasurement keeps
+// instead, to first order, how its value depends on each raw input sample:
+// one term per sample, the derivative with respect to the sample times the
+// sample's error. The samples are independent, so the variance is the sum of
+// the squared terms.
+//
+// A quantity computed from all the samples, like g, would make every
+// expression using it dense. It is registered once in ErrorSources as a
+// derived source, with its terms over all the inputs, and expressions refer
+// to it with a single term; the variance then adds the covariances between
+// the derived source and the inputs. Expressions stay at a handful of terms,
+// kept inline without allocations.
+//
+
+// Sources the terms of a TrackedMeasurement refer to: ids [0, inputs) are the
+// independent input samples and the derived sources come after them.
+class ErrorSources {
+  private:
+    std::size_t _inputs;
+    // Terms of each derived source over all the inputs.
+    std::vector<std::vector<double>> _derived;
+    // Covariances between derived sources.
+    std::vector<std::vector<double>> _derived_covariance;
+
+  public:
+    explicit ErrorSources(std::size_t inputs) : _inputs{inputs} {}
+
+    bool is_input(std::uint32_t id) const { return id < _inputs; }
+    // Registers a derived source given its terms over all the inputs. Returns
+    // its id.
+    std::uint32_t add_derived(std::vector<double> terms);
+    // Covariance between sources a and b.
+    double covariance(std::uint32_t a, std::uint32_t b) const;
+};
+
+// Coefficient of one source in a TrackedMeasurement.
+struct ErrorTerm {
+  std::uint32_t source;
+  double coefficient;
+};
+
+// Terms sorted by source. The first few are stored inline, the rest (if any)
+// on the heap.
+class ErrorTerms {
+  private:
+    static constexpr std::size_t inline_capacity = 6;
+    std::size_t _size = 0;
+    ErrorTerm _inline[inline_capacity] = {};
+    std::vector<ErrorTerm> _heap;
+
+  public:
+    std::size_t size() const { return _size; }
+    ErrorTerm const *begin() const { return _size <= inline_capacity ? _inline : _heap.data(); }
+    ErrorTerm const *end() const { return begin() + _size; }
+    // Adds a term after all the others (sources must come in order).
+    void push_back(ErrorTerm t);
+
+    // a x + b y, merging the terms of the same source.
+    static ErrorTerms combine(double a, ErrorTerms const &x, double b, ErrorTerms const &y);
+};
+
+class TrackedMeasurement;
+
+inline TrackedMeasurement operator+(TrackedMeasurement const &a, TrackedMeasurement const &b);
+inline TrackedMeasurement operator-(TrackedMeasurement const &a, TrackedMeasurement const &b);
+inline TrackedMeasurement operator*(TrackedMeasurement const &a, TrackedMeasurement const &b);
+inline TrackedMeasurement operator*(double a, TrackedMeasurement const &b);
+inline TrackedMeasurement operator/(TrackedMeasurement const &a, TrackedMeasurement const &b);
+inline TrackedMeasurement operator/(TrackedMeasurement const &a, double b);
+
+// Measurement with first-order derivatives with respect to the sources. The
+// arithmetic is in double.
+class TrackedMeasurement {
+  private:
+    double _value;
+    ErrorTerms _terms;
+    ErrorSources const *_sources = nullptr;
+
+    TrackedMeasurement(double value, ErrorTerms terms, ErrorSources const *sources)
+        : _value{value}, _terms{std::move(terms)}, _sources{sources} {}
+    // Sources of the result of an operation on a and b.
+    static ErrorSources const *sources_of(TrackedMeasurement const &a, TrackedMeasurement const &b) {
+      return a._sources ? a._sources : b._sources;
+    }
+
+  public:
+    //-----------------------------------------------------------------------------
+    // Arithmetic operations, propagating the derivatives.
+
+    friend TrackedMeasurement operator+(TrackedMeasurement const &a, TrackedMeasurement const &b);
+    friend TrackedMeasurement operator-(TrackedMeasurement const &a, TrackedMeasurement const &b);
+    friend TrackedMeasurement operator*(TrackedMeasurement const &a, TrackedMeasurement const &b);
+    friend TrackedMeasurement operator*(double a, TrackedMeasurement const &b);
+    friend TrackedMeasurement operator/(TrackedMeasurement const &a, TrackedMeasurement const &b);
+    friend TrackedMeasurement operator/(TrackedMeasurement const &a, double b);
+
+    friend std::ostream& operator<<(std::ostream &os, TrackedMeasurement const &a){
+      os << a.measurement();
+      return os;
+    }
+
+    // A constant, with no error.
+    TrackedMeasurement(double value = 0) : _value{value} {}
+    // Source id of sources with the given value; coefficient is its error
+    // for an input sample and 1 for a derived source.
+    TrackedMeasurement(ErrorSources const &sources, std::uint32_t id, double value,
+                       double coefficient)
+        : _value{value}, _sources{&sources} {
+      _terms.push_back({id, coefficient});
+    }
+
+    double value() const { return _value; }
+    // Linearized error, with all the correlations between the terms.
+    double error() const;
+    Measurement<double> measurement() const { return {_value, error()}; }
+};
+
+//-----------------------------------------------------------------------------
+// Type and class to represent the time and positions of the particle. With errors.
+//
+template<typename T>
+struct ParticlePosition {
+  Measurement<T> time;   // Time
+  Measurement<T> height; // Associated height
+};
+
+//-----------------------------------------------------------------------------
+// Errors reading trajectory files.
+
+// Base of the errors reading a trajectory file.
+class QuedaError : public std::runtime_error {
+  private:
+    std::string _filename;
+
+  public:
+    QuedaError(std::string const &filename, std::string const &message)
+        : std::runtime_error(message), _filename{filename} {}
+    std::string const &filename() const { return _filename; }
+};
+
+// The file cannot be opened or mapped.
+class FileReadError : public QuedaError {
+  private:
+    std::error_code _code;
+
+  public:
+    FileReadError(std::string const &filename, std::error_code code)
+        : QuedaError(filename, code.message()), _code{code} {}
+    std::error_code code() const { return _code; }
+};
+
+// A line that is not a valid position: not exactly 4 numbers, a value that is
+// not finite or a negative error. Column 0 means the whole line (and the
+// line is the row in columnar files).
+struct BadLine {
+  std::size_t line;
+  std::size_t column;
+  std::string reason;
+};
+
+// Bad lines found while reading a file. All are counted, only the first
+// max_listed are kept.
+struct ReadReport {
+  static constexpr std::size_t max_listed = 100;
+  std::size_t bad_lines = 0;
+  std::vector<BadLine> listed;
+
+  void add(BadLine bad) {
+    if (bad_lines++ < max_listed) listed.push_back(std::move(bad));
+  }
+};
+
+// The file has bad lines (and they are not being skipped) or is not a
+// trajectory file. what() lists the first few.
+class InvalidDataError : public QuedaError {
+  private:
+    ReadReport _report;
+
+  public:
+    InvalidDataError(std::string const &filename, ReadReport report);
+    ReadReport const &report() const { return _report; }
+};
+
+// What to do with bad lines: fail after reading the whole file (reporting
+// them all) or skip them.
+enum class BadLines { fail, skip };
+
+// Reads the positions in filename one at a time, in file order, calling
+// f(ParticlePosition<T>) for each valid line (T is float or double). Throws
+// FileReadError if the file cannot be opened. Bad lines are collected in the
+// returned report; with BadLines::fail, f is not called after the first and
+// InvalidDataError is thrown once the whole file has been checked.
+template<typename T, typename F>
+ReadReport parse_positions(std::string const &filename, F f, BadLines bad_lines = BadLines::fail);
+
+
+// Positions stored with scalar type T.
+template<typename T>
+class Positions {
+  public:
+    // Times and heights of all positions, in file order.
+    MeasurementArray<T> time;
+    MeasurementArray<T> height;
+
+    // Reads data from filename (see parse_positions for the errors).
+    ReadReport read_data(std::string filename, BadLines bad_lines = BadLines::fail);
+    // Adds a position at the end.
+    template<typename U>
+    void push_back(ParticlePosition<U> const &p) {
+      time.push_back(p.time);
+      height.push_back(p.height);
+    }
+    std::size_t size() const { return time.size(); }
+    // Class contructor
+    Positions(std::string _filename) {
+     read_data(_filename);
+    };
+    Positions() = default;
+};
+
+//-----------------------------------------------------------------------------
+// Weighted least-squares fit of the trajectory.
+//
+
+// Result of fitting h = a + b t + c t^2 to the positions.
+struct FitResult {
+  Measurement<double> g; // g = -2c, with its uncertainty
+  double chi2;           // Sum of the squared weighted residuals
+  std::size_t dof;       // Degrees of freedom (number of points - 3)
+  double rms_residual;   // Weighted RMS of the height residuals
+};
+
+// Fit of h = a + b t + c t^2 over all points, weighting each point by the
+// inverse of its effective variance error_h^2 + (dh/dt error_t)^2 (or by 1
+// when that is zero), so the time errors count as the height errors they
+// cause. The slope dh/dt comes from an earlier estimate of the trajectory
+// (see Slope); with none, only the height errors are used. Points are added
+// one at a time and only the sums of the normal equations are kept, so the
+// fit takes a single pass and constant memory.
+//
+// Times and heights are taken relative to the first point, which keeps the
+// sums well conditioned. The uncertainty of g comes from the covariance of the
+// fit.
+//
+// The sums are always in double, whatever the precision of the positions:
+// they are only a handful of numbers, so there is nothing to save in float.
+class QuadraticFit {
+  public:
+    // Estimate of the slope of the trajectory, dh/dt = b + 2 c (t - t0).
+    struct Slope {
+      double t0, b, c;
+      double at(double t) const { return b + 2 * c * (t - t0); }
+    };
+
+  private:
+    // Solves the normal equations: beta = (a, b, c) and the row of the
+    // inverse of M for c.
+    void solve(double beta[3], double row_c[3]) const;
+
+    Slope _slope = {0, 0, 0};
+    std::size_t _n = 0;
+    double _t0 = 0, _h0 = 0;
+    double _sw = 0;                   // sum of w
+    double _st[4] = {};               // sum of w t^k, k = 1..4
+    double _sh[3] = {};               // sum of w h t^k, k = 0..2
+    double _shh = 0;                  // sum of w h^2
+
+  public:
+    QuadraticFit() = default;
+    // Fit weighting the points with the given slope.
+    explicit QuadraticFit(Slope slope) : _slope{slope} {}
+
+    // Weight of a point at time t with the slope used by this fit.
+    static double weight(Slope const &slope, double t, double error_t, double error_h);
+
+    void add(double t, double error_t, double h, double error_h);
+    std::size_t size() const { return _n; }
+    // Solves the normal equations. Needs at least 3 points with distinct times.
+    FitResult result() const;
+    // Slope of the fitted trajectory (same requirements as result).
+    Slope slope() const;
+    // Changes the slope used to weight the next points.
+    void set_slope(Slope slope) { _slope = slope; }
+
+    // Linearization of g around the fitted solution, for correlated error
+    // propagation.
+    class Linearization {
+      private:
+        Slope _slope;
+        double _t0, _h0;
+        double _beta[3];
+        double _row_c[3];
+        friend class QuadraticFit;
+
+      public:
+        // Derivatives of g with respect to the time and the height of the point
+        // (t, h) with errors error_t and error_h, one of the fitted points.
+        void derivatives(double t, double error_t, double h, double error_h, double &dg_dt,
+                         double &dg_dh) const;
+    };
+    Linearization linearization() const;
+};
+
+// g and velocities with the errors propagated with all the correlations.
+struct CorrelatedResult {
+  Measurement<double> g;
+  std::vector<Measurement<double>> velocities;
+};
+
+// Fit and velocities of a trajectory, with the velocities stored as S.
+template<typename S>
+struct TrajectoryResult {
+  FitResult fit;
+  MeasurementArray<S> velocities;
+};
+
+//-----------------------------------------------------------------------------
+// Computations on a trajectory given as spans of times and heights, of the
+// same size and in time order. Spans of different sizes throw
+// std::invalid_argument.
+
+// Throws std::invalid_argument if the spans have different sizes.
+template<typename S>
+void check_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height);
+
+// Fits the trajectory to all the time and height data.
+template<typename S>
+FitResult fit_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height);
+
+// Velocity at each instant given the data and g, with the arithmetic in A.
+template<typename S, typename A>
+MeasurementArray<S> trajectory_velocities(MeasurementSpan<S> time, MeasurementSpan<S> height,
+                                          Measurement<A> g);
+
+// g and the velocities with the errors propagated through TrackedMeasurement
+// (in double): the error of g includes the time errors, and the errors of the
+// velocities the correlations between their terms and with g.
+template<typename S>
+CorrelatedResult correlated_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height);
+
+// Fit and velocities, as Compute but without copying the positions.
+template<typename S, typename A = arithmetic_t<S>>
+TrajectoryResult<S> analyze_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height);
+
+// Computes g and the velocities for positions stored as S, doing the
+// arithmetic on the velocities in A.
+template<typename S, typename A>
+class Compute : private Positions<S> {
+  public:
+    FitResult fit;
+    Measurement<A> g;
+    MeasurementArray<S> velocities;
+    // Class contructor
+    Compute(std::string _filename) : Compute(Positions<S>(_filename)) {};
+    // From positions already read.
+    explicit Compute(Positions<S> positions) : Positions<S>(std::move(positions)) {
+      fit = fit_trajectory(this->time.span(), this->height.span());
+      g = Measurement<A>(fit.g);
+      velocities = trajectory_velocities(this->time.span(), this->height.span(), g);
+    };
+    using Positions<S>::size;
+
+    // Same results with the errors propagated with all the correlations (see
+    // correlated_trajectory).
+    CorrelatedResult calculate_correlated() const {
+      return correlated_trajectory(this->time.span(), this->height.span());
+    }
+};
+
+//-----------------------------------------------------------------------------
+// Streaming computation of the velocities.
+//
+
+// Takes the positions one at a time and writes each velocity to os as soon as
+// the position after it arrives, keeping only a bounded window of positions.
+//
+// With calibration > 0, g is fitted to the first calibration positions (which
+// are held until then) and kept fixed for the rest of the stream. With
+// calibration == 0, each velocity uses the fit of all positions read so far
+// (from the third one on). In both cases the fit over all positions is
+// available at the end; it is not the same as trajectory_fit (see fit()).
+//
+// Positions are held as S and the velocities computed in A.
+template<typename S, typename A>
+class VelocityStream {
+  private:
+    std::ostream &_os;
+    std::size_t _calibration;
+    QuadraticFit _fit;
+    // Positions whose velocities were not written yet.
+    std::vector<ParticlePosition<S>> _window;
+    bool _has_g = false;
+    Measurement<A> _g;
+    std::size_t _count = 0;
+    Measurement<A> _last_velocity;
+    Measurement<A> _last_delta_t;
+
+    // Writes the velocity from position a to position b.
+    void write_velocity(ParticlePosition<S> const &a, ParticlePosition<S> const &b);
+    // Fixes g from the positions so far and writes the held velocities.
+    void start();
+
+  public:
+    VelocityStream(std::ostream &os, std::size_t calibration)
+        : _os{os}, _calibration{calibration} {
+      _window.reserve(calibration > 3 ? calibration : 3);
+    }
+
+    template<typename U>
+    void add(ParticlePosition<U> const &p);
+    // Writes the remaining velocities, including the last one.
+    void finish();
+
+    // Number of positions read.
+    std::size_t size() const { return _count; }
+    // g used for the velocities (the last estimate, if online).
+    Measurement<A> g() const { return _g; }
+    // Fit over all positions read. The positions held until g is fixed are
+    // fitted as in trajectory_fit, but each later one is weighted with the
+    // slope of the fit of the positions before it, not of the final fit:
+    // that would need the positions that were not kept.
+    FitResult fit() const { return _fit.result(); }
+};
+
+// Reads data from filename.
+template<typename T>
+ReadReport Positions<T>::read_data(std::string filename, BadLines bad_lines) {
+  RASTREIO_ESCOPO("Positions::read_data");
+  return parse_positions<arithmetic_t<T>>(filename, [&](auto const &p) { push_back(p); },
+                                          bad_lines);
+}
+
+// Checks the values of a position. Returns why it is bad, or nullptr.
+template<typename T>
+char const *invalid_position(T const values[4]) {
+  for (int i = 0; i < 4; ++i) {
+    if (!std::isfinite(values[i])) return "value is not finite";
+  }
+  if (values[1] < 0 || values[3] < 0) return "negative error";
+  return nullptr;
+}
+
+// Reads the positions in filename.
+// The data are in the format:
+//
+// <time> <time error> <height> <height error>.
+//
+// All are floating point numbers, one position per line. Blank lines are
+// ignored.
+template<typename T, typename F>
+ReadReport parse_positions(std::string const &filename, F f, BadLines bad_lines) {
+  RASTREIO_ESCOPO("parse_positions");
+  ReadReport report;
+  std::size_t used = 0;
+  // With BadLines::fail the data are rejected after the first bad line, but
+  // the rest of the file is still checked so that all are reported at once.
+  auto bad = [&](std::size_t line, std::size_t column, char const *reason) {
+    report.add({line, column, reason});
+  };
+  auto use = [&](T const values[4]) {
+    if (report.bad_lines > 0 && bad_lines == BadLines::fail) return;
+    Measurement<T> t{values[0], values[1]};
+    Measurement<T> h{values[2], values[3]};
+    f(ParticlePosition<T>{t, h});
+    ++used;
+  };
+
+  // The file is memory mapped and parsed in place (see comum/leitura.hpp).
+  std::unique_ptr<ArquivoMapeado> datafile;
+  try {
+    datafile = std::make_unique<ArquivoMapeado>(filename);
+  } catch (std::system_error const &e) {
+    throw FileReadError(filename, e.code());
+  }
+  auto contents = datafile->conteudo();
+
+  // Binary columnar files (see comum/colunar.hpp) are read directly, with no
+  // text parsing.
+  if (e_colunar(contents)) {
+    std::unique_ptr<ArquivoColunar> columns;
+    try {
+      columns = std::make_unique<ArquivoColunar>(contents);
+    } catch (ErroFormato const &e) {
+      bad(0, 0, e.what());
+      throw InvalidDataError(filename, std::move(report));
+    }
+    if (columns->esquema() != Esquema::queda) {
+      bad(0, 0, "not a trajectory file");
+      throw InvalidDataError(filename, std::move(report));
+    }
+    T values[4];
+    for (size_t i = 0; i < columns->linhas(); ++i) {
+      for (std::uint32_t c = 0; c < 4; ++c) values[c] = columns->valor<T>(c, i);
+      if (auto reason = invalid_position(values)) bad(i + 1, 0, reason);
+      else use(values);
+    }
+  } else {
+    LeitorNumeros reader(contents);
+    T values[4];
+    for (bool more = !contents.empty(); more; more = reader.proxima_linha()) {
+      // Read a position (time+height with errors): 4 values on the line.
+      char const *reason = nullptr;
+      int n = 0;
+      for (; n < 4; ++n) {
+        auto status = reader.le_na_linha(values[n]);
+        if (status == Leitura::ok) continue;
+        if (status == Leitura::fim_da_linha) reason = n > 0 ? "incomplete line" : nullptr;
+        else if (status == Leitura::invalido) reason = "invalid value";
+        else reason = "value out of range";
+        break;
+      }
+      if (n == 0 && reason == nullptr) continue;
+      if (n == 4 && !reader.no_fim_da_linha()) reason = "too many values";
+      if (reason) {
+        bad(reader.linha(), reader.coluna(), reason);
+      } else if ((reason = invalid_position(values))) {
+        bad(reader.linha(), 0, reason);
+      } else {
+        use(values);
+      }
+    }
+  }
+
+  RASTREIO_CONTA("positions", used);
+  RASTREIO_CONTA("bad_lines", report.bad_lines);
+  if (report.bad_lines > 0 && bad_lines == BadLines::fail) {
+    throw InvalidDataError(filename, std::move(report));
+  }
+  return report;
+}
+
+// Lists the first bad lines of a report, at most max.
+inline std::string describe_bad_lines(ReadReport const &report, std::size_t max) {
+  std::string s;
+  for (std::size_t i = 0; i < report.listed.size() && i < max; ++i) {
+    auto const &bad = report.listed[i];
+    if (i > 0) s += "; ";
+    if (bad.line > 0) s += "line " + std::to_string(bad.line);
+    if (bad.column > 0) s += ", column " + std::to_string(bad.column);
+    s += (bad.line > 0 ? ": " : "") + bad.reason;
+  }
+  if (report.bad_lines > max) s += "; ...";
+  return s;
+}
+
+inline InvalidDataError::InvalidDataError(std::string const &filename, ReadReport report)
+    : QuedaError(filename, report.bad_lines == 1 && report.listed[0].line == 0
+                               ? report.listed[0].reason
+                               : std::to_string(report.bad_lines) + " bad line" +
+                                     (report.bad_lines > 1 ? "s" : "") + ": " +
+                                     describe_bad_lines(report, 10)),
+      _report{std::move(report)} {}
+
+template<typename S>
+void check_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height) {
+  if (time.size != height.size) {
+    throw std::invalid_argument("trajectory with " + std::to_string(time.size) + " times and " +
+                                std::to_string(height.size) + " heights");
+  }
+}
+
+// Fit over all the points, which add_all adds to the fit it is given. The
+// weights need the slope of the trajectory, so the first pass uses only the
+// height errors and each of the next ones the slope of the pass before; the
+// slope hardly changes after the first one.
+template<typename F>
+QuadraticFit trajectory_passes(F add_all) {
+  QuadraticFit fit;
+  for (int pass = 0; pass < 3; ++pass) {
+    if (pass > 0) {
+      // The slope needs at least 3 points.
+      if (fit.size() < 3) break;
+      fit = QuadraticFit(fit.slope());
+    }
+    add_all(fit);
+  }
+  return fit;
+}
+
+// Fit over all the time and height data (see trajectory_passes).
+template<typename S>
+QuadraticFit trajectory_fit(MeasurementSpan<S> time, MeasurementSpan<S> height) {
+  check_trajectory(time, height);
+  auto const t = time.values;
+  auto const error_t = time.errors;
+  auto const h = height.values;
+  auto const error_h = height.errors;
+  return trajectory_passes([&](QuadraticFit &fit) {
+    for (std::size_t i = 0; i < time.size; ++i) fit.add(t[i], error_t[i], h[i], error_h[i]);
+  });
+}
+
+// Fits the trajectory to all the time and height data.
+template<typename S>
+FitResult fit_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height) {
+  RASTREIO_ESCOPO("fit_trajectory");
+  return trajectory_fit(time, height).result();
+}
+
+// Compute velocities in each instant given the data and
+// already evaluated g.
+template<typename S, typename A>
+MeasurementArray<S> trajectory_velocities(MeasurementSpan<S> time, MeasurementSpan<S> height,
+                                          Measurement<A> g) {
+  RASTREIO_ESCOPO("trajectory_velocities");
+  check_trajectory(time, height);
+  auto const n_data = time.size;
+  if (n_data < 2) return MeasurementArray<S>();
+
+  // For each data point (except the last, see below), evaluate the velocity as
+  // the starting velocity for a free fall to reach the next point.
+  //
+  // v = delta_h/delta_t + g*delta_t/2
+  //
+  // computed for all points at once on the arrays of times and heights, as a
+  // single fused loop.
+  auto delta_h = lazy<A>(height.drop_front(1)) - lazy<A>(height.first(n_data - 1));
+  auto delta_t = lazy<A>(time.drop_front(1)) - lazy<A>(time.first(n_data - 1));
+  auto velocities = evaluate<S>(n_data - 1, (delta_h / delta_t) + ((lazy(g) * delta_t) / 2.0f));
+
+  // The last velocity is evaluated from the one before last and the value of g.
+  auto last_delta_t = lazy<A>(time[n_data - 1]) - lazy<A>(time[n_data - 2]);
+  velocities.push_back(
+      evaluate(lazy<A>(velocities[n_data - 2]) - (lazy(g) * last_delta_t)));
+
+  return velocities;
+}
+
+// Same results with the errors propagated with all the correlations.
+template<typename S>
+CorrelatedResult correlated_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height) {
+  RASTREIO_ESCOPO("correlated_trajectory");
+  check_trajectory(time, height);
+  auto const n_data = time.size;
+  auto const t = time.values;
+  auto const error_t = time.errors;
+  auto const h = height.values;
+  auto const error_h = height.errors;
+
+  // The inputs are the time (id 2i) and the height (id 2i + 1) of each point.
+  // g is a derived source, with the terms of the fit over all of them.
+  auto const fit = trajectory_fit(time, height);
+  auto const linearization = fit.linearization();
+  std::vector<double> g_terms(2 * n_data);
+  for (std::size_t i = 0; i < n_data; ++i) {
+    double dg_dt, dg_dh;
+    linearization.derivatives(t[i], error_t[i], h[i], error_h[i], dg_dt, dg_dh);
+    g_terms[2 * i] = dg_dt * double(error_t[i]);
+    g_terms[2 * i + 1] = dg_dh * double(error_h[i]);
+  }
+  ErrorSources sources(2 * n_data);
+  auto g_id = sources.add_derived(std::move(g_terms));
+  TrackedMeasurement g(sources, g_id, fit.result().g.value(), 1.0);
+
+  auto time_at = [&](std::size_t i) {
+    return TrackedMeasurement(sources, std::uint32_t(2 * i), t[i], error_t[i]);
+  };
+  auto height_at = [&](std::size_t i) {
+    return TrackedMeasurement(sources, std::uint32_t(2 * i + 1), h[i], error_h[i]);
+  };
+
+  CorrelatedResult result;
+  result.g = g.measurement();
+  if (n_data < 2) return result;
+  result.velocities.reserve(n_data);
+
+  // Same formulas as trajectory_velocities.
+  TrackedMeasurement velocity, delta_t;
+  for (std::size_t i = 0; i + 1 < n_data; ++i) {
+    auto delta_h = height_at(i + 1) - height_at(i);
+    delta_t = time_at(i + 1) - time_at(i);
+    velocity = (delta_h / delta_t) + ((g * delta_t) / 2.0);
+    result.velocities.push_back(velocity.measurement());
+  }
+  result.velocities.push_back((velocity - (g * delta_t)).measurement());
+
+  return result;
+}
+
+// Fit and velocities of a trajectory.
+template<typename S, typename A>
+TrajectoryResult<S> analyze_trajectory(MeasurementSpan<S> time, MeasurementSpan<S> height) {
+  TrajectoryResult<S> result;
+  result.fit = fit_trajectory(time, height);
+  result.velocities = trajectory_velocities(time, height, Measurement<A>(result.fit.g));
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of arithmetic operations on measurements with errors.
+// The error propagation formulas assume that the error are Gaussian
+// and independent (uncorrelated) in the two measurements (see
+// TrackedMeasurement for correlated errors).
+//
+
+template<typename T>
+inline T square(T x) { return x * x; }
+
+template<typename T>
+Measurement<T> operator+(Measurement<T> const &a, Measurement<T> const &b) {
+  return {a._value + b._value, std::sqrt(square(a._error) + square(b._error))};
+}
+
+template<typename T>
+Measurement<T> operator-(Measurement<T> const &a, Measurement<T> const &b) {
+  return {a._value - b._value, std::sqrt(square(a._error) + square(b._error))};
+}
+
+template<typename T>
+Measurement<T> operator*(Measurement<T> const &a, Measurement<T> const &b) {
+  auto _value = a._value * b._value;
+  return {_value, std::fabs(_value) * std::sqrt(square(a._error / a._value) +
+                                              square(b._error / b._value))};
+}
+
+template<typename T>
+Measurement<T> operator*(no_deduce_t<T> a, Measurement<T> const &b) {
+  return {a * b._value, std::fabs(a) * b._error};
+}
+
+template<typename T>
+Measurement<T> operator/(Measurement<T> const &a, Measurement<T> const &b) {
+  auto _value = a._value / b._value;
+  return {_value, std::fabs(_value) * std::sqrt(square(a._error / a._value) +
+                                              square(b._error / b._value))};
+}
+
+template<typename T>
+Measurement<T> operator/(Measurement<T> const &a, no_deduce_t<T> b) {
+  return {a._value / b, a._error / std::fabs(b)};
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of elementwise operations on measurement arrays. Each loop
+// applies the same formulas as the single measurement operations above, in
+// the arithmetic type R of the stored scalars.
+//
+
+template<typename T>
+MeasurementArray<T> operator+(MeasurementSpan<T> a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(a.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < a.size; ++i) {
+    rv[i] = T(R(a.values[i]) + R(b.values[i]));
+    re[i] = T(std::sqrt(square(R(a.errors[i])) + square(R(b.errors[i]))));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator-(MeasurementSpan<T> a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(a.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < a.size; ++i) {
+    rv[i] = T(R(a.values[i]) - R(b.values[i]));
+    re[i] = T(std::sqrt(square(R(a.errors[i])) + square(R(b.errors[i]))));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator*(MeasurementSpan<T> a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(a.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < a.size; ++i) {
+    R _value = R(a.values[i]) * R(b.values[i]);
+    rv[i] = T(_value);
+    re[i] = T(std::fabs(_value) * std::sqrt(square(R(a.errors[i]) / R(a.values[i])) +
+                                            square(R(b.errors[i]) / R(b.values[i]))));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator*(Measurement<arithmetic_t<T>> const &a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(b.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  auto const relative_a = square(a.error() / a.value());
+  for (std::size_t i = 0; i < b.size; ++i) {
+    R _value = a.value() * R(b.values[i]);
+    rv[i] = T(_value);
+    re[i] = T(std::fabs(_value) * std::sqrt(relative_a + square(R(b.errors[i]) / R(b.values[i]))));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator*(no_deduce_t<arithmetic_t<T>> a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(b.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < b.size; ++i) {
+    rv[i] = T(a * R(b.values[i]));
+    re[i] = T(std::fabs(a) * R(b.errors[i]));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator/(MeasurementSpan<T> a, MeasurementSpan<T> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(a.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < a.size; ++i) {
+    R _value = R(a.values[i]) / R(b.values[i]);
+    rv[i] = T(_value);
+    re[i] = T(std::fabs(_value) * std::sqrt(square(R(a.errors[i]) / R(a.values[i])) +
+                                            square(R(b.errors[i]) / R(b.values[i]))));
+  }
+  return r;
+}
+
+template<typename T>
+MeasurementArray<T> operator/(MeasurementSpan<T> a, no_deduce_t<arithmetic_t<T>> b) {
+  using R = arithmetic_t<T>;
+  MeasurementArray<T> r(a.size);
+  T *__restrict rv = r.values();
+  T *__restrict re = r.errors();
+  for (std::size_t i = 0; i < a.size; ++i) {
+    rv[i] = T(R(a.values[i]) / b);
+    re[i] = T(R(a.errors[i]) / std::fabs(b));
+  }
+  return r;
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of correlated error propagation.
+//
+
+inline std::uint32_t ErrorSources::add_derived(std::vector<double> terms) {
+  // Covariances with the derived sources already registered (and itself).
+  std::vector<double> covariance;
+  for (std::size_t d = 0; d <= _derived.size(); ++d) {
+    auto const &other = d < _derived.size() ? _derived[d] : terms;
+    double sum = 0;
+    for (std::size_t k = 0; k < _inputs; ++k) sum += terms[k] * other[k];
+    covariance.push_back(sum);
+    if (d < _derived.size()) _derived_covariance[d].push_back(sum);
+  }
+  _derived.push_back(std::move(terms));
+  _derived_covariance.push_back(std::move(covariance));
+  return std::uint32_t(_inputs + _derived.size() - 1);
+}
+
+inline double ErrorSources::covariance(std::uint32_t a, std::uint32_t b) const {
+  if (is_input(a) && is_input(b)) return a == b ? 1 : 0;
+  if (is_input(a)) return _derived[b - _inputs][a];
+  if (is_input(b)) return _derived[a - _inputs][b];
+  return _derived_covariance[a - _inputs][b - _inputs];
+}
+
+inline void ErrorTerms::push_back(ErrorTerm t) {
+  if (_size < inline_capacity) {
+    _inline[_size] = t;
+  } else {
+    if (_size == inline_capacity) _heap.assign(_inline, _inline + inline_capacity);
+    _heap.push_back(t);
+  }
+  ++_size;
+}
+
+inline ErrorTerms ErrorTerms::combine(double a, ErrorTerms const &x, double b, ErrorTerms const &y) {
+  ErrorTerms r;
+  auto i = x.begin(), j = y.begin();
+  while (i != x.end() || j != y.end()) {
+    if (j == y.end() || (i != x.end() && i->source < j->source)) {
+      r.push_back({i->source, a * i->coefficient});
+      ++i;
+    } else if (i == x.end() || j->source < i->source) {
+      r.push_back({j->source, b * j->coefficient});
+      ++j;
+    } else {
+      r.push_back({i->source, a * i->coefficient + b * j->coefficient});
+      ++i;
+      ++j;
+    }
+  }
+  return r;
+}
+
+inline double TrackedMeasurement::error() const {
+  // Inputs are independent with unit variance (the coefficients already
+  // include their errors); derived sources add their covariances with
+  // everything else. Derived sources come after all the inputs.
+  double variance = 0;
+  for (auto const &a: _terms) {
+    if (_sources == nullptr || _sources->is_input(a.source)) {
+      variance += a.coefficient * a.coefficient;
+      continue;
+    }
+    for (auto const &b: _terms) {
+      double covariance = _sources->covariance(a.source, b.source);
+      // Input-derived pairs appear once here, so they count twice.
+      variance += (_sources->is_input(b.source) ? 2 : 1) * a.coefficient * b.coefficient * covariance;
+    }
+  }
+  return std::sqrt(variance);
+}
+
+inline TrackedMeasurement operator+(TrackedMeasurement const &a, TrackedMeasurement const &b) {
+  return {a._value + b._value, ErrorTerms::combine(1, a._terms, 1, b._terms),
+          TrackedMeasurement::sources_of(a, b)};
+}
+
+inline TrackedMeasurement operator-(TrackedMeasurement const &a, TrackedMeasurement const &b) {
+  return {a._value - b._value, ErrorTerms::combine(1, a._terms, -1, b._terms),
+          TrackedMeasurement::sources_of(a, b)};
+}
+
+inline TrackedMeasurement operator*(TrackedMeasurement const &a, TrackedMeasurement const &b) {
+  return {a._value * b._value, ErrorTerms::combine(b._value, a._terms, a._value, b._terms),
+          TrackedMeasurement::sources_of(a, b)};
+}
+
+inline TrackedMeasurement operator*(double a, TrackedMeasurement const &b) {
+  return {a * b._value, ErrorTerms::combine(a, b._terms, 0, ErrorTerms()), b._sources};
+}
+
+inline TrackedMeasurement operator/(TrackedMeasurement const &a, TrackedMeasurement const &b) {
+  double q = a._value / b._value;
+  return {q, ErrorTerms::combine(1 / b._value, a._terms, -q / b._value, b._terms),
+          TrackedMeasurement::sources_of(a, b)};
+}
+
+inline TrackedMeasurement operator/(TrackedMeasurement const &a, double b) {
+  return {a._value / b, ErrorTerms::combine(1 / b, a._terms, 0, ErrorTerms()), a._sources};
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of the least-squares fit.
+//
+
+inline double QuadraticFit::weight(Slope const &slope, double t, double error_t, double error_h) {
+  double error_t_h = slope.at(t) * error_t;
+  double variance = error_h * error_h + error_t_h * error_t_h;
+  return variance > 0 ? 1 / variance : 1;
+}
+
+inline void QuadraticFit::add(double t, double error_t, double h, double error_h) {
+  if (_n == 0) {
+    _t0 = t;
+    _h0 = h;
+  }
+  ++_n;
+  double w = weight(_slope, t, error_t, error_h);
+  t -= _t0;
+  h -= _h0;
+  double wt = w * t;
+  double wt2 = wt * t;
+  _sw += w;
+  _st[0] += wt;
+  _st[1] += wt2;
+  _st[2] += wt2 * t;
+  _st[3] += wt2 * t * t;
+  _sh[0] += w * h;
+  _sh[1] += wt * h;
+  _sh[2] += wt2 * h;
+  _shh += w * h * h;
+}
+
+inline void QuadraticFit::solve(double beta[3], double row_c[3]) const {
+  // Normal equations M (a b c) = y, with M symmetric:
+  //
+  //   | sw  st1 st2 |       | sh0 |
+  //   | st1 st2 st3 |   y = | sh1 |
+  //   | st2 st3 st4 |       | sh2 |
+  //
+  // solved through the inverse of M, which is also the covariance of the
+  // parameters.
+  double m00 = _sw, m01 = _st[0], m02 = _st[1];
+  double m11 = _st[1], m12 = _st[2], m22 = _st[3];
+
+  double c00 = m11 * m22 - m12 * m12;
+  double c01 = m02 * m12 - m01 * m22;
+  double c02 = m01 * m12 - m02 * m11;
+  double c11 = m00 * m22 - m02 * m02;
+  double c12 = m01 * m02 - m00 * m12;
+  double c22 = m00 * m11 - m01 * m01;
+  double det = m00 * c00 + m01 * c01 + m02 * c02;
+
+  beta[0] = (c00 * _sh[0] + c01 * _sh[1] + c02 * _sh[2]) / det;
+  beta[1] = (c01 * _sh[0] + c11 * _sh[1] + c12 * _sh[2]) / det;
+  beta[2] = (c02 * _sh[0] + c12 * _sh[1] + c22 * _sh[2]) / det;
+  row_c[0] = c02 / det;
+  row_c[1] = c12 / det;
+  row_c[2] = c22 / det;
+}
+
+inline FitResult QuadraticFit::result() const {
+  double beta[3], row_c[3];
+  solve(beta, row_c);
+  double a = beta[0], b = beta[1], c = beta[2];
+  double var_c = row_c[2];
+
+  FitResult r;
+  r.dof = _n > 3 ? _n - 3 : 0;
+  // Sum of w (h - a - b t - c t^2)^2 expanded in terms of the sums, using
+  // M (a b c) = y.
+  r.chi2 = std::fmax(0.0, _shh - (a * _sh[0] + b * _sh[1] + c * _sh[2]));
+  r.rms_residual = std::sqrt(r.chi2 / _sw);
+  r.g = Measurement<double>(-2 * c, 2 * std::sqrt(var_c));
+  return r;
+}
+
+inline QuadraticFit::Slope QuadraticFit::slope() const {
+  double beta[3], row_c[3];
+  solve(beta, row_c);
+  return {_t0, beta[1], beta[2]};
+}
+
+inline QuadraticFit::Linearization QuadraticFit::linearization() const {
+  Linearization l;
+  l._slope = _slope;
+  l._t0 = _t0;
+  l._h0 = _h0;
+  solve(l._beta, l._row_c);
+  return l;
+}
+
+inline void QuadraticFit::Linearization::derivatives(double t, double error_t, double h,
+                                                     double error_h, double &dg_dt,
+                                                     double &dg_dh) const {
+  // With phi = (1, t, t^2) (times relative to t0), c = m . y for m the row
+  // of the inverse of M for c, and g = -2c:
+  //
+  //   dc/dh = w (m . phi)
+  //   dc/dt = w [r (m . phi') - (beta . phi') (m . phi)]
+  //
+  // where phi' = (0, 1, 2t) and r = h - beta . phi is the residual. The
+  // weights are taken as constants, as in the fit.
+  double w = weight(_slope, t, error_t, error_h);
+  t -= _t0;
+  h -= _h0;
+  double m_phi = _row_c[0] + _row_c[1] * t + _row_c[2] * t * t;
+  double m_dphi = _row_c[1] + 2 * _row_c[2] * t;
+  double slope = _beta[1] + 2 * _beta[2] * t;
+  double r = h - (_beta[0] + _beta[1] * t + _beta[2] * t * t);
+  dg_dh = -2 * w * m_phi;
+  dg_dt = -2 * w * (r * m_dphi - slope * m_phi);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Implementation of the streaming computation of the velocities.
+//
+
+template<typename S, typename A>
+void VelocityStream<S, A>::write_velocity(ParticlePosition<S> const &a, ParticlePosition<S> const &b) {
+  // Same formula as trajectory_velocities.
+  auto delta_h = lazy<A>(b.height) - lazy<A>(a.height);
+  auto delta_t = lazy<A>(b.time) - lazy<A>(a.time);
+  _last_velocity = evaluate((delta_h / delta_t) + ((lazy(_g) * delta_t) / 2.0f));
+  _last_delta_t = evaluate(delta_t);
+  _os << _last_velocity << '\n';
+}
+
+template<typename S, typename A>
+void VelocityStream<S, A>::start() {
+  // All positions so far are held and were weighted with the slopes of fewer
+  // points; fit them again as trajectory_fit does.
+  _fit = trajectory_passes([&](QuadraticFit &fit) {
+    for (auto const &p: _window) {
+      fit.add(p.time.value(), p.time.error(), p.height.value(), p.height.error());
+    }
+  });
+  _g = Measurement<A>(_fit.result().g);
+  _has_g = true;
+  if (_calibration > 0) {
+    _os << "Gravitational acceleration (first " << _fit.size()
+        << " points): " << _g << '\n';
+  }
+  _os << "Velocities:\n";
+  for (std::size_t i = 0; i + 1 < _window.size(); ++i) {
+    write_velocity(_window[i], _window[i + 1]);
+  }
+  _window.erase(_window.begin(), _window.end() - 1);
+}
+
+template<typename S, typename A>
+template<typename U>
+void VelocityStream<S, A>::add(ParticlePosition<U> const &position) {
+  ParticlePosition<S> p{Measurement<S>(position.time), Measurement<S>(position.height)};
+  // Each position is weighted with the slope of the fit of the ones before.
+  if (_fit.size() >= 3) _fit.set_slope(_fit.slope());
+  _fit.add(p.time.value(), p.time.error(), p.height.value(), p.height.error());
+  ++_count;
+  if (!_has_g) {
+    _window.push_back(p);
+    if (_window.size() >= (_calibration > 0 ? _calibration : 3)) start();
+    return;
+  }
+  if (_calibration == 0) _g = Measurement<A>(_fit.result().g);
+  write_velocity(_window[0], p);
+  _window[0] = p;
+}
+
+template<typename S, typename A>
+void VelocityStream<S, A>::finish() {
+  if (!_has_g) {
+    if (_window.empty()) return;
+    start();
+  }
+  // The last velocity is evaluated from the one before last and the value of g.
+  if (_count >= 2) {
+    _os << evaluate(lazy(_last_velocity) - (lazy(_g) * lazy(_last_delta_t))) << '\n';
+  }
+  _window.clear();
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef TAREFA3_ORDERED_UNIQUE_VALUES_HPP
+#define TAREFA3_ORDERED_UNIQUE_VALUES_HPP
+
+#include <algorithm>
+#include <vector>
+#include <exception>
+#include <iterator>
+
+// Clase do erro gerado
+class LimitedOrderedUniqueValuesOverLimit : public std::exception {
+  int _value_inserted;
+  int _size_max;
+
+  public:
+    LimitedOrderedUniqueValuesOverLimit(int value, int size) : _value_inserted{value}, _size_max{size} {}
+
+    virtual const char* what() const throw() {
+      return "Erro na inserção de um novo valor, tamanho excedido.";
+    }
+
+    int get_size() const { return _size_max; }
+    int get_inserted_value() const { return _value_inserted; }
+};
+
+// Classe que mantem um conjunto de valores sem duplicacao e em ordem crescente.
+// Permite verificar a existencia ou nao de um valor e pegar uma faixa de
+// elementos entre dois valores especificados.
+// Muitos valores de uma vez devem ser inseridos com insert_range (ou com o
+// construtor a partir de uma faixa de iteradores), que custa O(k log k + n)
+// para k valores novos em vez de O(k n) de k chamadas a insert.
+class OrderedUniqueValues {
+  // Invariante:
+  // Se size() > 1 && 0 <= i < size()-1 então _data[i] < data[i+1]
+  std::vector<int> _data;
+
+public:
+  // Sinonimmo de um tipo para iterador para os elementos.
+  using const_iterator = std::vector<int>::const_iterator;
+
+  OrderedUniqueValues() = default;
+
+  // Cria o conjunto com os valores de [first, last), em qualquer ordem e com
+  // repeticoes.
+  template<typename Iterator>
+  OrderedUniqueValues(Iterator first, Iterator last) {
+    insert_range(first, last);
+  }
+
+  // Verifica se um elementos com o dado valor foi inserido.
+  bool find(int value) {
+    // Como os dados estao ordenados em _data, entao basta fazer uma busca
+    // binaria.
+    return std::binary_search(begin(_data), end(_data), value);
+  }
+
+  // Retorna um par de iteradores para o primeiro e um depois do ultimo
+  // valores que sao maiores ou iguais a min_value e menores ou iguais a
+  // max_value.
+  std::pair<const_iterator, const_iterator> find_range(int min_value,
+                                                       int max_value) const {
+    // Dados ordenados em _data, entao podemos usar lower_bound e upper_bound.
+    // Encontra o primeiro elemento que tem valor maior ou igual a min_value.
+    auto first = std::lower_bound(begin(_data), end(_data), min_value);
+    // Encontra o primeiro elemento que tem valor maior do que max_value.
+    auto last = std::upper_bound(begin(_data), end(_data), max_value);
+    return {first, last};
+  }
+
+  // Numero de elementos correntemente armazenados.
+  size_t size() const { return _data.size(); }
+
+  // Insere um novo elemento, se nao existir ainda.
+  virtual void insert(int value) {
+    auto [first, last] = std::equal_range(begin(_data), end(_data), value);
+    if (first == last) {
+      _data.insert(last, value);
+    }
+  }
+
+  // Insere os valores de [first, last) que nao existirem ainda. O lote e
+  // ordenado e sem repeticoes e entao juntado com _data por insert_sorted.
+  template<typename Iterator>
+  void insert_range(Iterator first, Iterator last) {
+    std::vector<int> values(first, last);
+    std::sort(begin(values), end(values));
+    values.erase(std::unique(begin(values), end(values)), end(values));
+    insert_sorted(values);
+  }
+
+  virtual ~OrderedUniqueValues() {};
+
+protected:
+  // Insere valores ordenados e sem repeticoes: sao acrescentados no fim de
+  // _data e juntados com os antigos em uma unica passada linear.
+  virtual void insert_sorted(std::vector<int> const &values) {
+    auto n = _data.size();
+    _data.insert(end(_data), begin(values), end(values));
+    std::inplace_merge(begin(_data), begin(_data) + n, end(_data));
+    _data.erase(std::unique(begin(_data), end(_data)), end(_data));
+  }
+
+  // Valores de values (ordenados e sem repeticoes) que nao estao em _data.
+  std::vector<int> missing(std::vector<int> const &values) const {
+    std::vector<int> result;
+    std::set_difference(begin(values), end(values), begin(_data), end(_data),
+                        std::back_inserter(result));
+    return result;
+  }
+
+};
+
+//Classe derivada do OrderedUniqueValues com um tamanho máximo definido
+class LimitedOrderedUniqueValues : public OrderedUniqueValues {
+
+private:
+  int _limit;
+
+public:
+  LimitedOrderedUniqueValues(int max) : _limit{max} {};
+
+  template<typename Iterator>
+  LimitedOrderedUniqueValues(int max, Iterator first, Iterator last) : _limit{max} {
+    insert_range(first, last);
+  }
+
+  void insert(int value) override {
+    if (static_cast<int>(OrderedUniqueValues::size()) == _limit) {
+      throw LimitedOrderedUniqueValuesOverLimit(value, _limit);
+    } else {
+      OrderedUniqueValues::insert(value);
+    }
+  }
+
+protected:
+  // Se os valores novos nao couberem, nenhum e inserido e o erro informa o
+  // primeiro deles (em ordem crescente) que passaria do limite.
+  void insert_sorted(std::vector<int> const &values) override {
+    auto new_values = missing(values);
+    size_t room = _limit - static_cast<int>(OrderedUniqueValues::size());
+    if (new_values.size() > room) {
+      throw LimitedOrderedUniqueValuesOverLimit(new_values[room], _limit);
+    }
+    OrderedUniqueValues::insert_sorted(new_values);
+  }
+
+};
+
+#endif
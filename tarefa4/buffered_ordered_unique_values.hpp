@@ -0,0 +1,143 @@
+#ifndef TAREFA4_BUFFERED_ORDERED_UNIQUE_VALUES_HPP
+#define TAREFA4_BUFFERED_ORDERED_UNIQUE_VALUES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "ordered_unique_values.hpp"
+
+// Variante do OrderedUniqueValues otimizada para insercoes misturadas com
+// buscas. Os valores novos vao para um buffer pequeno, ordenado, e so sao
+// juntados ao conjunto principal (um OrderedUniqueValues) quando o buffer
+// passa do limite: max(min_buffer, raiz de n) valores. Assim cada insert
+// move O(raiz de n) elementos amortizados em vez de O(n), e as buscas
+// continuam sendo buscas binarias, no principal e no buffer.
+// find_range retorna iteradores que percorrem os dois em ordem.
+template<typename Type>
+class BufferedOrderedUniqueValues {
+  // Invariante:
+  // _buffer ordenado e sem repeticoes, e nenhum valor esta em _main e em
+  // _buffer ao mesmo tempo.
+  OrderedUniqueValues<Type> _main;
+  std::vector<Type> _buffer;
+  std::size_t _min_buffer;
+
+public:
+  // Iterador que percorre em ordem crescente uma faixa do principal e uma do
+  // buffer, sempre no menor dos dois proximos valores.
+  class const_iterator {
+    using main_iterator = typename OrderedUniqueValues<Type>::const_iterator;
+    using buffer_iterator = typename std::vector<Type>::const_iterator;
+
+    main_iterator _main, _main_end;
+    buffer_iterator _buffer, _buffer_end;
+
+    bool in_buffer() const {
+      return _main == _main_end || (_buffer != _buffer_end && *_buffer < *_main);
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Type const *;
+    using reference = Type const &;
+
+    const_iterator() = default;
+    const_iterator(main_iterator main, main_iterator main_end, buffer_iterator buffer,
+                   buffer_iterator buffer_end)
+        : _main{main}, _main_end{main_end}, _buffer{buffer}, _buffer_end{buffer_end} {}
+
+    reference operator*() const { return in_buffer() ? *_buffer : *_main; }
+    pointer operator->() const { return &**this; }
+
+    const_iterator &operator++() {
+      if (in_buffer()) ++_buffer;
+      else ++_main;
+      return *this;
+    }
+    const_iterator operator++(int) {
+      auto old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const_iterator const &o) const {
+      return _main == o._main && _buffer == o._buffer;
+    }
+    bool operator!=(const_iterator const &o) const { return !(*this == o); }
+
+    // Numero de elementos entre dois iteradores da mesma faixa.
+    difference_type operator-(const_iterator const &o) const {
+      return (_main - o._main) + (_buffer - o._buffer);
+    }
+  };
+
+  explicit BufferedOrderedUniqueValues(std::size_t min_buffer = 1024)
+      : _min_buffer{min_buffer} {}
+
+  // Cria o conjunto com os valores de [first, last), em qualquer ordem e com
+  // repeticoes.
+  template<typename Iterator>
+  BufferedOrderedUniqueValues(Iterator first, Iterator last, std::size_t min_buffer = 1024)
+      : _main(first, last), _min_buffer{min_buffer} {}
+
+  // Verifica se um elementos com o dado valor foi inserido.
+  bool find(Type value) const {
+    return _main.find(value) || std::binary_search(begin(_buffer), end(_buffer), value);
+  }
+
+  // Retorna um par de iteradores para o primeiro e um depois do ultimo
+  // valores que sao maiores ou iguais a min_value e menores ou iguais a
+  // max_value, juntando as faixas do principal e do buffer.
+  std::pair<const_iterator, const_iterator> find_range(Type min_value,
+                                                       Type max_value) const {
+    auto [main_first, main_last] = _main.find_range(min_value, max_value);
+    auto buffer_first = std::lower_bound(begin(_buffer), end(_buffer), min_value);
+    auto buffer_last = std::upper_bound(begin(_buffer), end(_buffer), max_value);
+    return {const_iterator(main_first, main_last, buffer_first, buffer_last),
+            const_iterator(main_last, main_last, buffer_last, buffer_last)};
+  }
+
+  // Numero de elementos correntemente armazenados.
+  std::size_t size() const { return _main.size() + _buffer.size(); }
+
+  // Numero de elementos no buffer, ainda nao juntados ao principal.
+  std::size_t buffered() const { return _buffer.size(); }
+
+  // Insere um novo elemento, se nao existir ainda.
+  void insert(Type value) {
+    if (_main.find(value)) return;
+    auto [first, last] = std::equal_range(begin(_buffer), end(_buffer), value);
+    if (first != last) return;
+    _buffer.insert(last, value);
+    if (_buffer.size() > limit()) flush();
+  }
+
+  // Insere os valores de [first, last) que nao existirem ainda, juntando-os
+  // direto ao principal com o buffer.
+  template<typename Iterator>
+  void insert_range(Iterator first, Iterator last) {
+    flush();
+    _main.insert_range(first, last);
+  }
+
+  // Junta o buffer ao principal em uma unica passada linear.
+  void flush() {
+    if (_buffer.empty()) return;
+    _main.insert_range(begin(_buffer), end(_buffer));
+    _buffer.clear();
+  }
+
+private:
+  // Tamanho a partir do qual o buffer e juntado ao principal.
+  std::size_t limit() const {
+    return std::max(_min_buffer, static_cast<std::size_t>(std::sqrt(double(_main.size()))));
+  }
+};
+
+#endif
@@ -0,0 +1,240 @@
+#ifndef TAREFA4_CONCURRENT_ORDERED_UNIQUE_VALUES_HPP
+#define TAREFA4_CONCURRENT_ORDERED_UNIQUE_VALUES_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "buffered_ordered_unique_values.hpp"
+#include "ordered_unique_values.hpp"
+
+// Indice da thread corrente entre as threads vivas. O indice de uma thread
+// que termina e reaproveitado pela proxima que pedir um.
+inline std::size_t current_thread_index() {
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::size_t> free;
+    std::size_t next{0};
+  };
+  static Registry registry;
+  struct Index {
+    std::size_t value;
+    Index() {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      if (registry.free.empty()) {
+        value = registry.next++;
+      } else {
+        value = registry.free.back();
+        registry.free.pop_back();
+      }
+    }
+    ~Index() {
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.free.push_back(value);
+    }
+  };
+  thread_local Index index;
+  return index.value;
+}
+
+// Variante do OrderedUniqueValues para varias threads, em que as leituras
+// nao usam travas. O conjunto e uma sequencia de versoes imutaveis
+// (Snapshot): cada insert cria uma versao nova, publicada com uma troca
+// atomica de ponteiro, e os leitores sempre usam a versao publicada quando
+// comecaram. Como em BufferedOrderedUniqueValues, uma versao e um conjunto
+// principal, compartilhado entre as versoes, mais um buffer pequeno dos
+// valores novos, entao um insert copia so o buffer (O(raiz de n)) e so
+// quando o buffer passa do limite o principal e refeito.
+//
+// Os escritores sao serializados por uma trava; os leitores so anunciam em
+// uma posicao propria (uma linha de cache por thread) a epoca em que
+// comecaram, e uma versao substituida so e apagada quando nenhum leitor que
+// possa estar usando-a continua ativo (reclamacao por epocas).
+//
+// find pode ser chamado direto. Para find_range, cujos iteradores apontam
+// para dentro de uma versao, a leitura e feita por um Reader (read()), que
+// mantem a sua versao enquanto existir. Acima de max_readers threads
+// simultaneas os leitores excedentes usam a trava dos escritores.
+// O conjunto nao pode ser destruido com leitores ativos.
+template<typename Type>
+class ConcurrentOrderedUniqueValues {
+public:
+  // Numero de threads que leem sem travas ao mesmo tempo.
+  static constexpr std::size_t max_readers = 256;
+
+  typedef typename BufferedOrderedUniqueValues<Type>::const_iterator const_iterator;
+
+private:
+  // Uma versao imutavel do conjunto.
+  struct Snapshot {
+    // Invariante: buffer ordenado, sem repeticoes e sem valores de main.
+    std::shared_ptr<OrderedUniqueValues<Type> const> main;
+    std::vector<Type> buffer;
+
+    bool find(Type value) const {
+      return main->find(value) || std::binary_search(begin(buffer), end(buffer), value);
+    }
+
+    std::pair<const_iterator, const_iterator> find_range(Type min_value, Type max_value) const {
+      auto [main_first, main_last] = main->find_range(min_value, max_value);
+      auto buffer_first = std::lower_bound(begin(buffer), end(buffer), min_value);
+      auto buffer_last = std::upper_bound(begin(buffer), end(buffer), max_value);
+      return {const_iterator(main_first, main_last, buffer_first, buffer_last),
+              const_iterator(main_last, main_last, buffer_last, buffer_last)};
+    }
+
+    std::size_t size() const { return main->size() + buffer.size(); }
+  };
+
+  // Epoca em que o leitor de uma thread comecou, ou 0 se ele nao esta ativo.
+  // depth conta os Readers aninhados da thread e so e usado por ela.
+  struct alignas(64) ReaderSlot {
+    std::atomic<std::uint64_t> epoch{0};
+    std::size_t depth{0};
+  };
+
+  std::atomic<Snapshot const *> _current;
+  std::atomic<std::uint64_t> _epoch{1};
+  std::unique_ptr<ReaderSlot[]> _slots{new ReaderSlot[max_readers]};
+  // Trava dos escritores, recursiva porque a thread de um Reader excedente
+  // pode inserir enquanto le.
+  mutable std::recursive_mutex _writer;
+  // Readers excedentes ativos, todos da thread com a trava (protegido por
+  // ela). Enquanto houver algum, publish nao apaga versoes, porque eles nao
+  // anunciam epoca.
+  mutable std::size_t _locked_readers{0};
+  // Versoes substituidas e a epoca a partir da qual nenhum leitor novo as ve.
+  std::vector<std::pair<Snapshot const *, std::uint64_t>> _retired;
+  std::size_t _min_buffer;
+
+public:
+  // Leitura de uma versao do conjunto, sem travas. Os iteradores de
+  // find_range valem enquanto o Reader existir.
+  class Reader {
+    ConcurrentOrderedUniqueValues const *_set;
+    ReaderSlot *_slot{nullptr};
+    std::unique_lock<std::recursive_mutex> _lock;
+    Snapshot const *_snapshot;
+
+  public:
+    explicit Reader(ConcurrentOrderedUniqueValues const &set) : _set{&set} {
+      auto index = current_thread_index();
+      if (index < max_readers) {
+        _slot = &set._slots[index];
+        // A epoca anunciada antes de ler o ponteiro garante que o escritor
+        // ou ve este leitor ativo ou ja publicou a versao que ele vai ler.
+        if (_slot->depth++ == 0) _slot->epoch.store(set._epoch.load());
+      } else {
+        _lock = std::unique_lock<std::recursive_mutex>(set._writer);
+        ++set._locked_readers;
+      }
+      _snapshot = set._current.load();
+    }
+    Reader(Reader const &) = delete;
+    Reader &operator=(Reader const &) = delete;
+    ~Reader() {
+      if (_slot && --_slot->depth == 0) _slot->epoch.store(0, std::memory_order_release);
+      if (!_slot) --_set->_locked_readers;
+    }
+
+    // Verifica se um elementos com o dado valor foi inserido.
+    bool find(Type value) const { return _snapshot->find(value); }
+
+    // Retorna um par de iteradores para o primeiro e um depois do ultimo
+    // valores que sao maiores ou iguais a min_value e menores ou iguais a
+    // max_value.
+    std::pair<const_iterator, const_iterator> find_range(Type min_value,
+                                                         Type max_value) const {
+      return _snapshot->find_range(min_value, max_value);
+    }
+
+    // Numero de elementos nesta versao.
+    std::size_t size() const { return _snapshot->size(); }
+  };
+
+  explicit ConcurrentOrderedUniqueValues(std::size_t min_buffer = 1024)
+      : _current{new Snapshot{std::make_shared<OrderedUniqueValues<Type>>(), {}}},
+        _min_buffer{min_buffer} {}
+
+  ConcurrentOrderedUniqueValues(ConcurrentOrderedUniqueValues const &) = delete;
+  ConcurrentOrderedUniqueValues &operator=(ConcurrentOrderedUniqueValues const &) = delete;
+
+  ~ConcurrentOrderedUniqueValues() {
+    delete _current.load();
+    for (auto const &retired : _retired) delete retired.first;
+  }
+
+  // Leitura da versao corrente.
+  Reader read() const { return Reader(*this); }
+
+  // Verifica se um elementos com o dado valor foi inserido.
+  bool find(Type value) const { return read().find(value); }
+
+  // Numero de elementos correntemente armazenados.
+  std::size_t size() const { return read().size(); }
+
+  // Insere um novo elemento, se nao existir ainda.
+  void insert(Type value) {
+    std::lock_guard<std::recursive_mutex> lock(_writer);
+    auto old = _current.load();
+    if (old->find(value)) return;
+    auto next = std::make_unique<Snapshot>(*old);
+    next->buffer.insert(std::upper_bound(begin(next->buffer), end(next->buffer), value), value);
+    if (next->buffer.size() > limit(next->main->size())) merge(*next);
+    publish(next.release());
+  }
+
+  // Insere os valores de [first, last) que nao existirem ainda, em uma
+  // versao nova com o buffer e os valores juntados ao principal.
+  template<typename Iterator>
+  void insert_range(Iterator first, Iterator last) {
+    std::lock_guard<std::recursive_mutex> lock(_writer);
+    auto next = std::make_unique<Snapshot>(*_current.load());
+    next->buffer.insert(end(next->buffer), first, last);
+    merge(*next);
+    publish(next.release());
+  }
+
+private:
+  // Tamanho a partir do qual o buffer e juntado ao principal.
+  std::size_t limit(std::size_t n) const {
+    return std::max(_min_buffer, static_cast<std::size_t>(std::sqrt(double(n))));
+  }
+
+  // Troca o principal da versao por uma copia com o buffer juntado.
+  static void merge(Snapshot &snapshot) {
+    auto main = std::make_shared<OrderedUniqueValues<Type>>(*snapshot.main);
+    main->insert_range(begin(snapshot.buffer), end(snapshot.buffer));
+    snapshot.main = std::move(main);
+    snapshot.buffer.clear();
+  }
+
+  // Publica a versao nova e apaga as substituidas que nenhum leitor ativo
+  // pode estar usando. Chamado com a trava dos escritores.
+  void publish(Snapshot const *next) {
+    auto old = _current.exchange(next);
+    // Leitores que anunciarem esta epoca ou uma depois ja leem next.
+    _retired.push_back({old, _epoch.fetch_add(1) + 1});
+    // Um Reader excedente desta thread pode estar usando qualquer versao
+    // substituida; elas sao apagadas em um publish depois que ele terminar.
+    if (_locked_readers > 0) return;
+
+    std::uint64_t oldest = UINT64_MAX;
+    for (std::size_t i = 0; i < max_readers; ++i) {
+      auto epoch = _slots[i].epoch.load();
+      if (epoch != 0) oldest = std::min(oldest, epoch);
+    }
+    auto still_used = std::partition(begin(_retired), end(_retired),
+                                     [&](auto const &r) { return r.second > oldest; });
+    for (auto r = still_used; r != end(_retired); ++r) delete r->first;
+    _retired.erase(still_used, end(_retired));
+  }
+};
+
+#endif
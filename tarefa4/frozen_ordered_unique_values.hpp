@@ -0,0 +1,158 @@
+#ifndef TAREFA4_FROZEN_ORDERED_UNIQUE_VALUES_HPP
+#define TAREFA4_FROZEN_ORDERED_UNIQUE_VALUES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "ordered_unique_values.hpp"
+
+// Alocador que alinha os vetores a linhas de cache de 64 bytes.
+template<typename T>
+struct CacheAlignedAllocator {
+  using value_type = T;
+
+  CacheAlignedAllocator() = default;
+  template<typename U>
+  CacheAlignedAllocator(CacheAlignedAllocator<U> const &) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(64)));
+  }
+  void deallocate(T *p, std::size_t) { ::operator delete(p, std::align_val_t(64)); }
+
+  template<typename U>
+  bool operator==(CacheAlignedAllocator<U> const &) const { return true; }
+  template<typename U>
+  bool operator!=(CacheAlignedAllocator<U> const &) const { return false; }
+};
+
+// Versao so de leitura de um OrderedUniqueValues, com os valores em uma
+// arvore B+ implicita e estatica: cada no tem uma linha de cache de chaves
+// (16 ints, 8 doubles; ao menos 2 chaves para tipos maiores), as folhas sao
+// os proprios valores em ordem e cada chave de um no interno e o maior valor
+// do filho correspondente. Uma busca desce um no por nivel contando as chaves
+// menores que o valor procurado, uma comparacao sem desvios que o compilador
+// vetoriza para tipos aritmeticos, e le log_B(n) linhas de cache em vez das
+// log_2(n) de uma busca binaria em um vetor ordenado. Como as folhas sao
+// contiguas, find_range retorna iteradores para elas.
+template<typename Type>
+class FrozenOrderedUniqueValues {
+  using Vector = std::vector<Type, CacheAlignedAllocator<Type>>;
+
+  // Com um filho por no, a arvore nunca chegaria a raiz.
+  static constexpr std::size_t B = sizeof(Type) <= 32 ? 64 / sizeof(Type) : 2;
+
+  // Os n valores em ordem, completados com copias do maior ate um multiplo
+  // de B. Como rank trata antes os valores a partir do maior, as copias
+  // nunca sao contadas.
+  Vector _data;
+  std::size_t _size{0};
+  // Niveis internos, da raiz para as folhas, cada um com _offsets[k] como
+  // indice do seu primeiro no (vazio se ha uma folha so).
+  Vector _index;
+  std::vector<std::size_t> _offsets;
+
+public:
+  // Definição de um tipo de iterador para os elementos.
+  typedef typename Vector::const_iterator const_iterator;
+
+  FrozenOrderedUniqueValues() = default;
+
+  // Congela os valores de um OrderedUniqueValues.
+  explicit FrozenOrderedUniqueValues(OrderedUniqueValues<Type> const &values) {
+    build(values.values());
+  }
+
+  // Cria o conjunto com os valores de [first, last), em qualquer ordem e com
+  // repeticoes.
+  template<typename Iterator>
+  FrozenOrderedUniqueValues(Iterator first, Iterator last) {
+    build(OrderedUniqueValues<Type>(first, last).values());
+  }
+
+  // Verifica se um elementos com o dado valor foi inserido.
+  bool find(Type value) const {
+    auto i = rank<false>(value);
+    return i < _size && !(value < _data[i]);
+  }
+
+  // Retorna um par de iteradores para o primeiro e um depois do ultimo
+  // valores que sao maiores ou iguais a min_value e menores ou iguais a
+  // max_value.
+  std::pair<const_iterator, const_iterator> find_range(Type min_value,
+                                                       Type max_value) const {
+    auto first = rank<false>(min_value);
+    auto last = std::max(first, rank<true>(max_value));
+    return {_data.begin() + first, _data.begin() + last};
+  }
+
+  // Numero de elementos correntemente armazenados.
+  std::size_t size() const { return _size; }
+
+private:
+  void build(std::vector<Type> const &values) {
+    _size = values.size();
+    _data.clear();
+    _index.clear();
+    _offsets.clear();
+    if (_size == 0) return;
+    Type const &largest = values.back();
+    std::size_t nodes = (_size + B - 1) / B;
+    _data.assign(nodes * B, largest);
+    std::copy(values.begin(), values.end(), _data.begin());
+
+    // Monta os niveis das folhas para a raiz: cada no tem o maior valor de
+    // cada um dos seus B filhos.
+    std::vector<Type> maxes(nodes);
+    for (std::size_t m = 0; m < nodes; ++m) maxes[m] = values[std::min(_size, (m + 1) * B) - 1];
+    std::vector<std::vector<Type>> levels;
+    while (nodes > 1) {
+      std::size_t parents = (nodes + B - 1) / B;
+      std::vector<Type> level(parents * B, largest);
+      std::copy(maxes.begin(), maxes.end(), level.begin());
+      std::vector<Type> parent_maxes(parents);
+      for (std::size_t j = 0; j < parents; ++j) {
+        parent_maxes[j] = maxes[std::min(nodes, (j + 1) * B) - 1];
+      }
+      levels.push_back(std::move(level));
+      maxes = std::move(parent_maxes);
+      nodes = parents;
+    }
+
+    for (auto level = levels.rbegin(); level != levels.rend(); ++level) {
+      _offsets.push_back(_index.size());
+      _index.insert(_index.end(), level->begin(), level->end());
+    }
+  }
+
+  // Numero de chaves do no menores (ou, com inclusive, menores ou iguais) que
+  // value.
+  template<bool inclusive>
+  static std::size_t count(Type const *node, Type value) {
+    std::size_t c = 0;
+    for (std::size_t i = 0; i < B; ++i) {
+      c += inclusive ? !(value < node[i]) : node[i] < value;
+    }
+    return c;
+  }
+
+  // Posicao do primeiro valor maior ou igual (ou, com inclusive, maior) que
+  // value, como lower_bound (upper_bound).
+  template<bool inclusive>
+  std::size_t rank(Type value) const {
+    // Acima do maior valor, os filhos escolhidos nao existiriam.
+    if (_size == 0 || (inclusive ? !(value < _data[_size - 1]) : _data[_size - 1] < value)) {
+      return _size;
+    }
+    std::size_t node = 0;
+    for (auto offset: _offsets) {
+      node = node * B + count<inclusive>(_index.data() + offset + node * B, value);
+    }
+    return node * B + count<inclusive>(_data.data() + node * B, value);
+  }
+};
+
+#endif
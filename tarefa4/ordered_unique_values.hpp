@@ -0,0 +1,171 @@
+#ifndef TAREFA4_ORDERED_UNIQUE_VALUES_HPP
+#define TAREFA4_ORDERED_UNIQUE_VALUES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Classe que mantem um conjunto de valores sem duplicacao e em ordem crescente.
+// Permite verificar a existencia ou nao de um valor e pegar uma faixa de
+// elementos entre dois valores especificados.
+// Muitos valores de uma vez devem ser inseridos com insert_range (ou com o
+// construtor a partir de uma faixa de iteradores), que custa O(k log k + n)
+// para k valores novos em vez de O(k n) de k chamadas a insert. Da mesma
+// forma, muitas buscas de uma vez devem ser feitas com find_many e
+// find_range_many.
+// Template para diferentes tipos de dados do OrderedUniqueValues
+template<typename Type>
+class OrderedUniqueValues {
+  // Invariante:
+  // Se size() > 1 && 0 <= i < size()-1 então _data[i] < data[i+1]
+  std::vector<Type> _data;
+
+public:
+  // Definição de um tipo de iterador para os elementos.
+  typedef typename std::vector<Type>::const_iterator const_iterator;
+
+  OrderedUniqueValues() = default;
+
+  // Cria o conjunto com os valores de [first, last), em qualquer ordem e com
+  // repeticoes.
+  template<typename Iterator>
+  OrderedUniqueValues(Iterator first, Iterator last) {
+    insert_range(first, last);
+  }
+
+  // Verifica se um elementos com o dado valor foi inserido.
+  bool find(Type value) const {
+    // Como os dados estao ordenados em _data, entao basta fazer uma busca
+    // binaria.
+    return std::binary_search(begin(_data), end(_data), value);
+  }
+
+  // Retorna um par de iteradores para o primeiro e um depois do ultimo
+  // valores que sao maiores ou iguais a min_value e menores ou iguais a
+  // max_value.
+  std::pair<const_iterator, const_iterator> find_range(Type min_value,
+                                                       Type max_value) const {
+    // Dados ordenados em _data, entao podemos usar lower_bound e upper_bound.
+    // Encontra o primeiro elemento que tem valor maior ou igual a min_value.
+    auto first = std::lower_bound(begin(_data), end(_data), min_value);
+    // Encontra o primeiro elemento que tem valor maior do que max_value.
+    auto last = std::upper_bound(begin(_data), end(_data), max_value);
+    return {first, last};
+  }
+
+  // Numero de elementos correntemente armazenados.
+  size_t size() const { return _data.size(); }
+
+  // Todos os valores, em ordem crescente.
+  std::vector<Type> const &values() const { return _data; }
+
+  // Insere um novo elemento, se nao existir ainda.
+  void insert(Type value) {
+    auto [first, last] = std::equal_range(begin(_data), end(_data), value);
+    if (first == last) {
+      _data.insert(last, value);
+    }
+  }
+
+  // Insere os valores de [first, last) que nao existirem ainda. Os valores
+  // sao acrescentados no fim de _data, ordenados e sem repeticoes, e entao
+  // juntados com os antigos em uma unica passada linear.
+  template<typename Iterator>
+  void insert_range(Iterator first, Iterator last) {
+    auto n = _data.size();
+    _data.insert(end(_data), first, last);
+    auto middle = begin(_data) + n;
+    std::sort(middle, end(_data));
+    _data.erase(std::unique(middle, end(_data)), end(_data));
+    std::inplace_merge(begin(_data), begin(_data) + n, end(_data));
+    _data.erase(std::unique(begin(_data), end(_data)), end(_data));
+  }
+
+  // Escreve em out[i] se keys[i] foi inserido, para i em [0, n). Chaves em
+  // ordem crescente sao procuradas avancando por _data junto com elas
+  // (merge-join, com busca exponencial a partir da ultima posicao achada);
+  // as outras em grupos de buscas binarias intercaladas (ver bounds).
+  void find_many(Type const *keys, std::size_t n, bool *out) const {
+    if (std::is_sorted(keys, keys + n)) {
+      std::size_t position = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+        position = gallop(position, keys[i]);
+        out[i] = position < _data.size() && !(keys[i] < _data[position]);
+      }
+      return;
+    }
+    for (std::size_t i = 0; i < n; i += group) {
+      std::size_t m = std::min(group, n - i);
+      std::size_t positions[group];
+      bounds<false>(keys + i, m, positions);
+      for (std::size_t j = 0; j < m; ++j) {
+        out[i + j] = positions[j] < _data.size() && !(keys[i + j] < _data[positions[j]]);
+      }
+    }
+  }
+
+  // Escreve em out[i] o resultado de find_range(min_values[i],
+  // max_values[i]), para i em [0, n), com as buscas intercaladas.
+  void find_range_many(Type const *min_values, Type const *max_values, std::size_t n,
+                       std::pair<const_iterator, const_iterator> *out) const {
+    for (std::size_t i = 0; i < n; i += group) {
+      std::size_t m = std::min(group, n - i);
+      std::size_t first[group], last[group];
+      bounds<false>(min_values + i, m, first);
+      bounds<true>(max_values + i, m, last);
+      for (std::size_t j = 0; j < m; ++j) {
+        out[i + j] = {begin(_data) + first[j], begin(_data) + std::max(first[j], last[j])};
+      }
+    }
+  }
+
+private:
+  // Numero de buscas intercaladas por bounds.
+  static constexpr std::size_t group = 16;
+
+  // Escreve em positions as posicoes de lower_bound (ou, com upper, de
+  // upper_bound) de keys[0, m), m <= group. As m buscas binarias descem
+  // juntas, um nivel de cada vez e sem desvios, entao as leituras de memoria
+  // de todas ficam pendentes ao mesmo tempo em vez de uma esperar a outra.
+  template<bool upper>
+  void bounds(Type const *keys, std::size_t m, std::size_t *positions) const {
+    Type const *data = _data.data();
+    std::size_t length = _data.size();
+    if (length == 0) {
+      std::fill(positions, positions + m, 0);
+      return;
+    }
+    Type const *base[group];
+    std::fill(base, base + m, data);
+    while (length > 1) {
+      std::size_t half = length / 2;
+      for (std::size_t j = 0; j < m; ++j) {
+        bool right = upper ? !(keys[j] < base[j][half - 1]) : base[j][half - 1] < keys[j];
+        // multiplicacao e nao ?: para o compilador nao gerar um desvio
+        base[j] += right * half;
+      }
+      length -= half;
+    }
+    for (std::size_t j = 0; j < m; ++j) {
+      bool right = upper ? !(keys[j] < *base[j]) : *base[j] < keys[j];
+      positions[j] = (base[j] - data) + right;
+    }
+  }
+
+  // lower_bound de value a partir de position, sabendo que todos os valores
+  // antes de position sao menores: avanca em passos que dobram ate passar de
+  // value e termina com uma busca binaria no ultimo passo.
+  std::size_t gallop(std::size_t position, Type value) const {
+    std::size_t step = 1, high = position;
+    while (high < _data.size() && _data[high] < value) {
+      position = high + 1;
+      high += step;
+      step *= 2;
+    }
+    high = std::min(high, _data.size());
+    return std::lower_bound(begin(_data) + position, begin(_data) + high, value) - begin(_data);
+  }
+};
+
+#endif
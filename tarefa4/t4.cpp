@@ -1,162 +1,241 @@
-#include <algorithm>
-#include <iostream>
-#include <vector>
-
-// Classe que mantem um conjunto de valores sem duplicacao e em ordem crescente.
-// Permite verificar a existencia ou nao de um valor e pegar uma faixa de
-// elementos entre dois valores especificados.
-// Template para diferentes tipos de dados do OrderedUniqueValues
-template<typename Type>
-class OrderedUniqueValues {
-  // Invariante:
-  // Se size() > 1 && 0 <= i < size()-1 então _data[i] < data[i+1]
-  std::vector<Type> _data;
-
-public:
-  // Definição de um tipo de iterador para os elementos.
-  typedef typename std::vector<Type>::const_iterator const_iterator;
-
-  // Verifica se um elementos com o dado valor foi inserido.
-  bool find(Type value) {
-    // Como os dados estao ordenados em _data, entao basta fazer uma busca
-    // binaria.
-    return std::binary_search(begin(_data), end(_data), value);
-  }
-
-  // Retorna um par de iteradores para o primeiro e um depois do ultimo
-  // valores que sao maiores ou iguais a min_value e menores ou iguais a
-  // max_value.
-  std::pair<const_iterator, const_iterator> find_range(Type min_value,
-                                                       Type max_value) const {
-    // Dados ordenados em _data, entao podemos usar lower_bound e upper_bound.
-    // Encontra o primeiro elemento que tem valor maior ou igual a min_value.
-    auto first = std::lower_bound(begin(_data), end(_data), min_value);
-    // Encontra o primeiro elemento que tem valor maior do que max_value.
-    auto last = std::upper_bound(begin(_data), end(_data), max_value);
-    return {first, last};
-  }
-
-  // Numero de elementos correntemente armazenados.
-  size_t size() const { return _data.size(); }
-
-  // Insere um novo elemento, se nao existir ainda.
-  void insert(Type value) {
-    auto [first, last] = std::equal_range(begin(_data), end(_data), value);
-    if (first == last) {
-      _data.insert(last, value);
-    }
-  }
-};
-
-
-int main(int, char *[]) {
-  // Alguns testes simples.
-  
-  // Definição dos valores e do tamanho
-  std::vector<int> some_values_int{7, -10, 4, 8, -2, 9, -10, 8, -5, 6, -9, 5};
-  std::vector<float> some_values_float{7.124125, -10.1251, 4, 8.6126, -2.152, 9.10, -10.1251, 8.6126, -5.26, 6.12, -9.5, 5.6};
-  std::vector<double> some_values_double{7.152, -10.9125601276, 4.152, 8.12516, -2.5261, 9.5126, -10.9125601276, 8.12516, -5.11, 6.63666125123, -9.6365135, 5.613513};
-  std::vector<size_t> some_sizes{1, 2, 3, 4, 5, 6, 6, 6, 7, 8, 9, 10};
-
-  // Criação das classes com os diferentes tipos de dados
-  OrderedUniqueValues<int> ouv_int;
-  OrderedUniqueValues<float> ouv_float;
-  OrderedUniqueValues<double> ouv_double;
-  
-  // Testes com o int
-  for (size_t i = 0; i < some_values_int.size(); ++i) {
-    ouv_int.insert(some_values_int[i]);
-    if (ouv_int.size() != some_sizes[i]) {
-      std::cerr << "Erro de insercao int: indice " << i
-                << ", valor: " << some_values_int[i]
-                << ", tamanho esperado: " << some_sizes[i]
-                << ", tamanho obtido: " << ouv_int.size() << std::endl;
-    }
-  }
-
-  for (auto x : some_values_int) {
-    if (!ouv_int.find(x)) {
-      std::cerr << "Nao achou valor int inserido " << x << std::endl;
-    }
-  }
-
-  auto [first1, last1] = ouv_int.find_range(0, 9);
-  for (auto current = first1; current != last1; ++current) {
-    if (*current < 0) {
-      std::cerr << "Erro na selecao dos valores int nao-negativos: " << *current
-                << std::endl;
-    }
-  }
-  auto [first2, last2] = ouv_int.find_range(-10, 0);
-  for (auto current = first2; current != last2; ++current) {
-    if (*current >= 0) {
-      std::cerr << "Erro na selecao dos valores int negativos: " << *current
-                << std::endl;
-    }
-  }
-
-  // Testes com o float
-  for (size_t i = 0; i < some_values_float.size(); ++i) {
-    ouv_float.insert(some_values_float[i]);
-    if (ouv_float.size() != some_sizes[i]) {
-      std::cerr << "Erro de insercao float: indice " << i
-                << ", valor: " << some_values_float[i]
-                << ", tamanho esperado: " << some_sizes[i]
-                << ", tamanho obtido: " << ouv_float.size() << std::endl;
-    }
-  }
-
-  for (auto x : some_values_float) {
-    if (!ouv_float.find(x)) {
-      std::cerr << "Nao achou valor float inserido " << x << std::endl;
-    }
-  }
-
-  auto [first3, last3] = ouv_float.find_range(0.0, 9.0);
-  for (auto current = first3; current != last3; ++current) {
-    if (*current < 0) {
-      std::cerr << "Erro na selecao dos valores float nao-negativos: " << *current
-                << std::endl;
-    }
-  }
-  auto [first4, last4] = ouv_float.find_range(-10, 0);
-  for (auto current = first4; current != last4; ++current) {
-    if (*current >= 0) {
-      std::cerr << "Erro na selecao dos valores float negativos: " << *current
-                << std::endl;
-    }
-  }
-
-  // Teste com o double
-  for (size_t i = 0; i < some_values_double.size(); ++i) {
-    ouv_double.insert(some_values_double[i]);
-    if (ouv_double.size() != some_sizes[i]) {
-      std::cerr << "Erro de insercao double: indice " << i
-                << ", valor: " << some_values_double[i]
-                << ", tamanho esperado: " << some_sizes[i]
-                << ", tamanho obtido: " << ouv_double.size() << std::endl;
-    }
-  }
-
-  for (auto x : some_values_double) {
-    if (!ouv_double.find(x)) {
-      std::cerr << "Nao achou valor double inserido " << x << std::endl;
-    }
-  }
-
-  auto [first5, last5] = ouv_double.find_range(0, 9);
-  for (auto current = first5; current != last5; ++current) {
-    if (*current < 0) {
-      std::cerr << "Erro na selecao dos valores double nao-negativos: " << *current
-                << std::endl;
-    }
-  }
-  auto [first6, last6] = ouv_double.find_range(-10, 0);
-  for (auto current = first6; current != last6; ++current) {
-    if (*current >= 0) {
-      std::cerr << "Erro na selecao dos valores double negativos: " << *current
-                << std::endl;
-    }
-  }
-  return 0;
-}
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffered_ordered_unique_values.hpp"
+#include "frozen_ordered_unique_values.hpp"
+#include "ordered_unique_values.hpp"
+
+int main(int, char *[]) {
+  // Alguns testes simples.
+  
+  // Definição dos valores e do tamanho
+  std::vector<int> some_values_int{7, -10, 4, 8, -2, 9, -10, 8, -5, 6, -9, 5};
+  std::vector<float> some_values_float{7.124125, -10.1251, 4, 8.6126, -2.152, 9.10, -10.1251, 8.6126, -5.26, 6.12, -9.5, 5.6};
+  std::vector<double> some_values_double{7.152, -10.9125601276, 4.152, 8.12516, -2.5261, 9.5126, -10.9125601276, 8.12516, -5.11, 6.63666125123, -9.6365135, 5.613513};
+  std::vector<size_t> some_sizes{1, 2, 3, 4, 5, 6, 6, 6, 7, 8, 9, 10};
+
+  // Criação das classes com os diferentes tipos de dados
+  OrderedUniqueValues<int> ouv_int;
+  OrderedUniqueValues<float> ouv_float;
+  OrderedUniqueValues<double> ouv_double;
+  
+  // Testes com o int
+  for (size_t i = 0; i < some_values_int.size(); ++i) {
+    ouv_int.insert(some_values_int[i]);
+    if (ouv_int.size() != some_sizes[i]) {
+      std::cerr << "Erro de insercao int: indice " << i
+                << ", valor: " << some_values_int[i]
+                << ", tamanho esperado: " << some_sizes[i]
+                << ", tamanho obtido: " << ouv_int.size() << std::endl;
+    }
+  }
+
+  for (auto x : some_values_int) {
+    if (!ouv_int.find(x)) {
+      std::cerr << "Nao achou valor int inserido " << x << std::endl;
+    }
+  }
+
+  auto [first1, last1] = ouv_int.find_range(0, 9);
+  for (auto current = first1; current != last1; ++current) {
+    if (*current < 0) {
+      std::cerr << "Erro na selecao dos valores int nao-negativos: " << *current
+                << std::endl;
+    }
+  }
+  auto [first2, last2] = ouv_int.find_range(-10, 0);
+  for (auto current = first2; current != last2; ++current) {
+    if (*current >= 0) {
+      std::cerr << "Erro na selecao dos valores int negativos: " << *current
+                << std::endl;
+    }
+  }
+
+  // Testes com o float
+  for (size_t i = 0; i < some_values_float.size(); ++i) {
+    ouv_float.insert(some_values_float[i]);
+    if (ouv_float.size() != some_sizes[i]) {
+      std::cerr << "Erro de insercao float: indice " << i
+                << ", valor: " << some_values_float[i]
+                << ", tamanho esperado: " << some_sizes[i]
+                << ", tamanho obtido: " << ouv_float.size() << std::endl;
+    }
+  }
+
+  for (auto x : some_values_float) {
+    if (!ouv_float.find(x)) {
+      std::cerr << "Nao achou valor float inserido " << x << std::endl;
+    }
+  }
+
+  auto [first3, last3] = ouv_float.find_range(0.0, 9.0);
+  for (auto current = first3; current != last3; ++current) {
+    if (*current < 0) {
+      std::cerr << "Erro na selecao dos valores float nao-negativos: " << *current
+                << std::endl;
+    }
+  }
+  auto [first4, last4] = ouv_float.find_range(-10, 0);
+  for (auto current = first4; current != last4; ++current) {
+    if (*current >= 0) {
+      std::cerr << "Erro na selecao dos valores float negativos: " << *current
+                << std::endl;
+    }
+  }
+
+  // Teste com o double
+  for (size_t i = 0; i < some_values_double.size(); ++i) {
+    ouv_double.insert(some_values_double[i]);
+    if (ouv_double.size() != some_sizes[i]) {
+      std::cerr << "Erro de insercao double: indice " << i
+                << ", valor: " << some_values_double[i]
+                << ", tamanho esperado: " << some_sizes[i]
+                << ", tamanho obtido: " << ouv_double.size() << std::endl;
+    }
+  }
+
+  for (auto x : some_values_double) {
+    if (!ouv_double.find(x)) {
+      std::cerr << "Nao achou valor double inserido " << x << std::endl;
+    }
+  }
+
+  auto [first5, last5] = ouv_double.find_range(0, 9);
+  for (auto current = first5; current != last5; ++current) {
+    if (*current < 0) {
+      std::cerr << "Erro na selecao dos valores double nao-negativos: " << *current
+                << std::endl;
+    }
+  }
+  auto [first6, last6] = ouv_double.find_range(-10, 0);
+  for (auto current = first6; current != last6; ++current) {
+    if (*current >= 0) {
+      std::cerr << "Erro na selecao dos valores double negativos: " << *current
+                << std::endl;
+    }
+  }
+
+  // Testes da insercao em lote: o resultado tem que ser o mesmo da insercao
+  // um a um, tambem juntando com valores ja existentes.
+  OrderedUniqueValues<int> bulk_int(some_values_int.begin(), some_values_int.begin() + 6);
+  bulk_int.insert_range(some_values_int.begin() + 6, some_values_int.end());
+  auto [first7, last7] = bulk_int.find_range(-10, 10);
+  auto [first8, last8] = ouv_int.find_range(-10, 10);
+  if (bulk_int.size() != ouv_int.size() || !std::equal(first7, last7, first8, last8)) {
+    std::cerr << "Erro na insercao em lote int: tamanho esperado: " << ouv_int.size()
+              << ", tamanho obtido: " << bulk_int.size() << std::endl;
+  }
+
+  OrderedUniqueValues<double> bulk_double;
+  bulk_double.insert_range(some_values_double.begin(), some_values_double.end());
+  bulk_double.insert_range(some_values_double.begin(), some_values_double.end());
+  auto [first9, last9] = bulk_double.find_range(-11, 10);
+  auto [first10, last10] = ouv_double.find_range(-11, 10);
+  if (bulk_double.size() != ouv_double.size() || !std::equal(first9, last9, first10, last10)) {
+    std::cerr << "Erro na insercao em lote double: tamanho esperado: " << ouv_double.size()
+              << ", tamanho obtido: " << bulk_double.size() << std::endl;
+  }
+
+  // Testes com o buffer de insercoes: com um buffer pequeno os valores sao
+  // juntados varias vezes e os resultados tem que ser os mesmos do
+  // OrderedUniqueValues, com parte dos valores ainda no buffer.
+  BufferedOrderedUniqueValues<int> buffered_int(4);
+  OrderedUniqueValues<int> reference_int;
+  for (int i = 0; i < 200; ++i) {
+    int x = (i * 37) % 101 - 50;
+    buffered_int.insert(x);
+    reference_int.insert(x);
+    if (buffered_int.size() != reference_int.size()) {
+      std::cerr << "Erro de insercao com buffer: indice " << i
+                << ", tamanho esperado: " << reference_int.size()
+                << ", tamanho obtido: " << buffered_int.size() << std::endl;
+    }
+  }
+  for (int x = -60; x <= 60; ++x) {
+    if (buffered_int.find(x) != reference_int.find(x)) {
+      std::cerr << "Erro na busca com buffer: valor " << x << std::endl;
+    }
+  }
+  buffered_int.insert_range(some_values_int.begin(), some_values_int.end());
+  buffered_int.insert(1000);
+  reference_int.insert_range(some_values_int.begin(), some_values_int.end());
+  reference_int.insert(1000);
+  auto [first11, last11] = buffered_int.find_range(-20, 1000);
+  auto [first12, last12] = reference_int.find_range(-20, 1000);
+  if (buffered_int.buffered() == 0 || last11 - first11 != last12 - first12 ||
+      !std::equal(first11, last11, first12, last12)) {
+    std::cerr << "Erro na selecao com buffer: tamanho esperado: " << last12 - first12
+              << ", tamanho obtido: " << last11 - first11 << std::endl;
+  }
+
+  // Testes com a versao congelada: buscas e faixas iguais as do
+  // OrderedUniqueValues, com tamanhos que dao de zero a tres niveis internos.
+  for (int n : {0, 1, 16, 17, 300, 5000}) {
+    OrderedUniqueValues<int> multiples;
+    for (int i = 0; i < n; ++i) multiples.insert(3 * i);
+    FrozenOrderedUniqueValues<int> frozen(multiples);
+    for (int x = -5; x <= 3 * n + 5; ++x) {
+      if (frozen.find(x) != multiples.find(x)) {
+        std::cerr << "Erro na busca congelada: n " << n << ", valor " << x << std::endl;
+      }
+      auto [first13, last13] = frozen.find_range(x, x + 7);
+      auto [first14, last14] = multiples.find_range(x, x + 7);
+      if (!std::equal(first13, last13, first14, last14)) {
+        std::cerr << "Erro na selecao congelada: n " << n << ", valor " << x << std::endl;
+      }
+    }
+  }
+  FrozenOrderedUniqueValues<double> frozen_double(some_values_double.begin(),
+                                                  some_values_double.end());
+  for (auto x : some_values_double) {
+    if (!frozen_double.find(x) || frozen_double.find(x + 0.5)) {
+      std::cerr << "Erro na busca congelada double: valor " << x << std::endl;
+    }
+  }
+  auto [first15, last15] = frozen_double.find_range(-10, 0);
+  if (frozen_double.size() != ouv_double.size() || last15 - first15 != 3) {
+    std::cerr << "Erro na selecao congelada double: tamanho " << last15 - first15 << std::endl;
+  }
+
+  // Tipos nao numericos e maiores que meia linha de cache.
+  std::vector<std::string> some_strings{"pera", "uva", "caju", "kiwi", "uva", "abacate"};
+  FrozenOrderedUniqueValues<std::string> frozen_string(some_strings.begin(), some_strings.end());
+  auto [first16, last16] = frozen_string.find_range("b", "pz");
+  if (!frozen_string.find("kiwi") || frozen_string.find("manga") || frozen_string.find("zz") ||
+      last16 - first16 != 3 || *first16 != "caju") {
+    std::cerr << "Erro na busca congelada string: tamanho " << last16 - first16 << std::endl;
+  }
+  std::vector<std::array<double, 10>> some_arrays;
+  for (int i = 0; i < 100; ++i) some_arrays.push_back({double((i * 37) % 100)});
+  FrozenOrderedUniqueValues<std::array<double, 10>> frozen_array(some_arrays.begin(),
+                                                                 some_arrays.end());
+  auto [first17, last17] = frozen_array.find_range({10.5}, {20});
+  if (!frozen_array.find({99}) || frozen_array.find({100}) || last17 - first17 != 10) {
+    std::cerr << "Erro na busca congelada array: tamanho " << last17 - first17 << std::endl;
+  }
+
+  // Testes das buscas em lote: os mesmos resultados de find e find_range,
+  // com as chaves fora de ordem e em ordem.
+  std::vector<int> keys;
+  for (int x = -60; x <= 60; ++x) keys.push_back((x * 53) % 61);
+  for (int sorted = 0; sorted < 2; ++sorted) {
+    if (sorted) std::sort(keys.begin(), keys.end());
+    bool found[121];
+    std::pair<OrderedUniqueValues<int>::const_iterator,
+              OrderedUniqueValues<int>::const_iterator> ranges[121];
+    std::vector<int> max_keys(keys);
+    for (auto &k : max_keys) k += 5;
+    reference_int.find_many(keys.data(), keys.size(), found);
+    reference_int.find_range_many(keys.data(), max_keys.data(), keys.size(), ranges);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (found[i] != reference_int.find(keys[i]) ||
+          ranges[i] != reference_int.find_range(keys[i], max_keys[i])) {
+        std::cerr << "Erro na busca em lote: valor " << keys[i] << std::endl;
+      }
+    }
+  }
+  return 0;
+}
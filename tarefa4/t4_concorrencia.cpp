@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "concurrent_ordered_unique_values.hpp"
+
+// Teste de estresse do ConcurrentOrderedUniqueValues: escritores inserem
+// valores enquanto leitores conferem, sem travas, que cada versao lida esta
+// em ordem, sem repeticoes, e tem todos os valores ja inseridos.
+//
+// Compilar: g++ -std=c++17 -O2 -pthread t4_concorrencia.cpp -o t4_concorrencia
+int main(int, char *[]) {
+  int const writers = 4, readers = 4, per_writer = 20000;
+
+  // Buffer pequeno para o principal ser refeito muitas vezes.
+  ConcurrentOrderedUniqueValues<int> set(16);
+  std::vector<std::atomic<int>> inserted(writers);
+  std::atomic<int> running_writers{writers};
+  std::atomic<long> errors{0}, reads{0};
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < writers; ++w) {
+    threads.emplace_back([&, w] {
+      // O escritor w insere w, w + writers, w + 2 writers, ... e alguns
+      // valores repetidos, um pouco em lotes.
+      for (int i = 0; i < per_writer; ++i) {
+        int value = w + writers * i;
+        if (i % 1000 == 999) {
+          std::vector<int> batch{value, value - writers, value};
+          set.insert_range(batch.begin(), batch.end());
+        } else {
+          set.insert(value);
+        }
+        if (i % 7 == 0) set.insert(w);
+        inserted[w].store(i + 1, std::memory_order_release);
+      }
+      --running_writers;
+    });
+  }
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&, r] {
+      std::mt19937 gen(r);
+      while (running_writers > 0) {
+        // Valores que os escritores ja terminaram de inserir.
+        int w = gen() % writers;
+        int done = inserted[w].load(std::memory_order_acquire);
+        auto reader = set.read();
+        if (done > 0) {
+          int value = w + writers * int(gen() % done);
+          if (!reader.find(value) || !set.find(value)) {
+            std::cerr << "Nao achou valor inserido " << value << std::endl;
+            ++errors;
+          }
+        }
+        if (reader.find(-1)) {
+          std::cerr << "Achou valor nao inserido -1" << std::endl;
+          ++errors;
+        }
+
+        // Uma faixa da versao lida tem que estar em ordem e sem repeticoes.
+        int min_value = gen() % (writers * per_writer);
+        auto [first, last] = reader.find_range(min_value, min_value + 1000);
+        for (auto current = first; current != last; ++current) {
+          auto next = current;
+          if (*current < min_value || *current > min_value + 1000 ||
+              (++next != last && !(*current < *next))) {
+            std::cerr << "Erro na selecao concorrente: " << *current << std::endl;
+            ++errors;
+            break;
+          }
+        }
+        auto [all_first, all_last] = reader.find_range(0, writers * per_writer);
+        if (static_cast<std::size_t>(all_last - all_first) != reader.size()) {
+          std::cerr << "Erro no tamanho da versao: " << reader.size() << std::endl;
+          ++errors;
+        }
+        ++reads;
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+
+  if (set.size() != static_cast<std::size_t>(writers * per_writer)) {
+    std::cerr << "Erro de insercao concorrente: tamanho esperado: " << writers * per_writer
+              << ", tamanho obtido: " << set.size() << std::endl;
+  }
+  for (int x = 0; x < writers * per_writer; ++x) {
+    if (!set.find(x)) {
+      std::cerr << "Nao achou valor inserido " << x << std::endl;
+      ++errors;
+      break;
+    }
+  }
+  if (reads == 0) std::cerr << "Nenhuma leitura durante as insercoes" << std::endl;
+
+  // Mais threads que max_readers ao mesmo tempo: as excedentes leem com a
+  // trava e inserem durante a leitura, e a versao lida tem que continuar
+  // valida.
+  int const many = int(ConcurrentOrderedUniqueValues<int>::max_readers) + 44;
+  ConcurrentOrderedUniqueValues<int> crowded(4);
+  std::atomic<int> started{0};
+  threads.clear();
+  for (int k = 0; k < many; ++k) {
+    threads.emplace_back([&, k] {
+      // Todas as threads pegam um indice antes de qualquer uma terminar.
+      current_thread_index();
+      ++started;
+      while (started < many) std::this_thread::yield();
+      auto reader = crowded.read();
+      auto size = reader.size();
+      for (int i = 0; i < 8; ++i) crowded.insert(8 * k + i);
+      auto [first, last] = reader.find_range(0, 8 * many);
+      if (reader.size() != size || static_cast<std::size_t>(last - first) != size ||
+          !std::is_sorted(first, last)) {
+        std::cerr << "Erro na leitura com muitas threads: " << k << std::endl;
+        ++errors;
+      }
+    });
+  }
+  for (auto &t : threads) t.join();
+  if (crowded.size() != static_cast<std::size_t>(8 * many)) {
+    std::cerr << "Erro de insercao com muitas threads: tamanho obtido: " << crowded.size()
+              << std::endl;
+    ++errors;
+  }
+  return errors > 0;
+}